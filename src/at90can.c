@@ -92,16 +92,31 @@ volatile uint8_t _messages_waiting;
 can_buffer_t can_tx_buffer;
 can_t can_tx_list[CAN_TX_BUFFER_SIZE];
 
-volatile uint8_t _transmission_in_progress = 0;
+volatile uint8_t _transmission_in_progress = 0;	//!< MObs which send the buffer when they are done
 #else
 volatile uint8_t _free_buffer;			//!< Stores the numer of currently free MObs
 #endif
 
+bool _one_shot_mode = false;
+
+#if CAN_RX_POLL_THRESHOLD > 0
+volatile uint8_t _rx_count;			//!< messages received since the last tick
+#endif
+
+#if SUPPORT_TIMESTAMPS
+volatile uint16_t _timer_overflows;	//!< upper 16 bit of the CAN timer
+volatile uint8_t _timestamp_mob = 0xff;	//!< MOb of can_send_timestamped_message()
+volatile uint16_t _tx_timestamp;
+volatile bool _tx_timestamp_valid;
+#endif
+
 // ----------------------------------------------------------------------------
 // get next free MOb
 
 uint8_t _find_free_mob(void)
 {
+	_release_one_shot_mobs();
+	
 	#if CAN_TX_BUFFER_SIZE == 0
 	if (_free_buffer == 0)
 		return 0xff;
@@ -111,7 +126,7 @@ uint8_t _find_free_mob(void)
 	#endif
 	
 	uint8_t i;
-	for (i = 0;i < 15;i++)
+	for (i = 0;i < AT90CAN_MOBS;i++)
 	{
 		// load MOb page
 		CANPAGE = i << 4;
@@ -164,11 +179,15 @@ bool at90can_init(uint8_t bitrate)
 	
 	// activate CAN transmit- and receive-interrupt
 	CANGIT = 0;
+	#if SUPPORT_TIMESTAMPS
+	CANGIE = (1 << ENIT) | (1 << ENRX) | (1 << ENTX) | (1 << ENOVRT);
+	#else
 	CANGIE = (1 << ENIT) | (1 << ENRX) | (1 << ENTX);
+	#endif
 	
-	// set timer prescaler to 199 which results in a timer
+	// set timer prescaler, the default of 199 results in a timer
 	// frequency of 10 kHz (at 16 MHz)
-	CANTCON = 199;
+	CANTCON = AT90CAN_TIMER_PRESCALER;
 	
 	// disable all filters
 	at90can_disable_filter( 0xff );
@@ -187,6 +206,181 @@ bool at90can_init(uint8_t bitrate)
 	return true;
 }
 
+// ----------------------------------------------------------------------------
+// Bookkeeping of a finished transmission which has to be done before the
+// MOb is used again. CANPAGE has to point to the MOb.
+
+void _transmission_done(uint8_t mob)
+{
+	#if SUPPORT_TIMESTAMPS
+	if (mob == _timestamp_mob)
+	{
+		// CANSTM holds the time of the end of frame
+		if (CANSTMOB & (1 << TXOK)) {
+			_tx_timestamp = CANSTM;
+			_tx_timestamp_valid = true;
+		}
+		_timestamp_mob = 0xff;
+	}
+	#else
+	(void) mob;
+	#endif
+}
+
+// ----------------------------------------------------------------------------
+// A transmission has finished (successful or not) => load the next message
+// from the buffer or release the MOb.
+// CANPAGE has to point to the MOb.
+
+static void _transmission_finished(uint8_t mob)
+{
+	_transmission_done(mob);
+	
+	// clear MOb
+	CANSTMOB &= 0;
+	CANCDMOB = 0;
+	
+	#if CAN_TX_BUFFER_SIZE > 0
+	can_t *buf = can_buffer_get_dequeue_ptr(&can_tx_buffer);
+	
+	#if CAN_TX_DEADLINE
+	// drop all messages which are already outdated
+	uint16_t now = CANTIM;
+	while (buf != NULL && buf->timestamp != 0 &&
+			(int16_t) (now - buf->timestamp) > 0)
+	{
+		can_buffer_dequeue(&can_tx_buffer);
+		_can_statistics.tx_expired++;
+		
+		buf = can_buffer_get_dequeue_ptr(&can_tx_buffer);
+	}
+	#endif
+	
+	// check if there are any another messages waiting 
+	if (buf != NULL)
+	{
+		at90can_copy_message_to_mob( buf );
+		can_buffer_dequeue(&can_tx_buffer);
+		
+		// enable transmission
+		CANCDMOB |= (1<<CONMOB0);
+	}
+	else {
+		// buffer underflow => no more messages to send
+		_disable_mob_interrupt(mob);
+		_transmission_in_progress--;
+	}
+	#else
+	_free_buffer++;
+	
+	// reset interrupt
+	if (mob < 8)
+		CANIE2 &= ~(1 << mob);
+	else
+		CANIE1 &= ~(1 << (mob - 8));
+	#endif
+}
+
+// ----------------------------------------------------------------------------
+// In one-shot mode a transmission which lost the arbitration is stopped
+// without any interrupt. These MObs are searched and released here.
+
+void _release_one_shot_mobs(void)
+{
+	if (!_one_shot_mode)
+		return;
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	uint8_t canpage = CANPAGE;
+	
+	for (uint8_t mob = 0; mob < AT90CAN_MOBS; mob++)
+	{
+		CANPAGE = mob << 4;
+		
+		if ((CANCDMOB & ((1 << CONMOB1) | (1 << CONMOB0))) != (1 << CONMOB0))
+			continue;
+		
+		bool enabled;
+		if (mob < 8)
+			enabled = CANEN2 & (1 << mob);
+		else
+			enabled = CANEN1 & (1 << (mob - 8));
+		
+		// results other than a lost arbitration are handled by the interrupt
+		if (!enabled && CANSTMOB == 0)
+		{
+			_transmission_finished(mob);
+			_can_statistics.tx_failed++;
+			
+			CAN_INDICATE_TX_FAILED_FUNCTION;
+		}
+	}
+	
+	CANPAGE = canpage;
+	CAN_LEAVE_CRITICAL_SECTION;
+}
+
+// ----------------------------------------------------------------------------
+// Copy a received message to the buffer (or its mailbox).
+// CANPAGE has to point to the MOb, the flags are not cleared.
+
+#if CAN_RX_BUFFER_SIZE > 0
+
+void _store_message(void)
+{
+	can_t *buf = can_buffer_get_enqueue_ptr(&can_rx_buffer);
+	
+	#if CAN_MAILBOX_SLOTS > 0 || CAN_CHANGE_FILTER_SLOTS > 0 || CAN_SUBSCRIPTION_SLOTS > 0
+	can_t msg;
+	at90can_copy_mob_to_message( &msg );
+	
+	// messages for a mailbox don't need any space in the buffer
+	#if CAN_MAILBOX_SLOTS > 0
+	if (_can_mailbox_update(&msg))
+		return;
+	#endif
+	
+	// the same for messages which didn't change
+	#if CAN_CHANGE_FILTER_SLOTS > 0
+	if (_can_suppress_unchanged(&msg))
+		return;
+	#endif
+	
+	// and for subscribed messages (FreeRTOS)
+	#if CAN_SUBSCRIPTION_SLOTS > 0
+	if (_can_subscription_dispatch(&msg))
+		return;
+	#endif
+	
+	if (buf != NULL)
+		*buf = msg;
+	#else
+	if (buf != NULL)
+		at90can_copy_mob_to_message( buf );
+	#endif
+	
+	if (buf == NULL) {
+		// buffer overflow => reject message
+		_can_statistics.rx_overflow++;
+	}
+	#if CAN_SHED_HIGH_WATERMARK > 0
+	else if (!can_buffer_accept(&can_rx_buffer, buf)) {
+		// buffer nearly full => drop low priority messages
+		_can_statistics.rx_shed++;
+	}
+	#endif
+	else {
+		// push it to the list
+		can_buffer_enqueue(&can_rx_buffer);
+		
+		#if CAN_FREERTOS
+		_can_freertos_rx_notify();
+		#endif
+	}
+}
+
+#endif
+
 // ----------------------------------------------------------------------------
 // The CANPAGE register have to be restored after usage, otherwise it
 // could cause trouble in the application programm.
@@ -205,63 +399,56 @@ ISR(CANIT_vect)
 		CANPAGE = CANHPMOB & 0xF0;
 		mob = (CANHPMOB >> 4);
 		
-		// a interrupt is only generated if a message was transmitted or received
-		if (CANSTMOB & (1 << TXOK))
+		#if CAN_AUTO_REPLY_SLOTS > 0
+		if (mob >= AT90CAN_AUTO_REPLY_MOB)
 		{
-			// clear MOb
+			// the reply was sent => wait for the next remote frame
 			CANSTMOB &= 0;
-			CANCDMOB = 0;
+			CANIDT4 |= (1 << RTRTAG);
+			CANCDMOB = (CANCDMOB & ((1 << IDE) | 0x0f)) |
+					   (1 << CONMOB1) | (1 << RPLV);
 			
-			#if CAN_TX_BUFFER_SIZE > 0
-			can_t *buf = can_buffer_get_dequeue_ptr(&can_tx_buffer);
+			CAN_INDICATE_TX_TRAFFIC_FUNCTION;
+		}
+		else
+		#endif
+		// a interrupt is only generated if a message was transmitted or received
+		if (CANSTMOB & (1 << TXOK))
+		{
+			_transmission_finished(mob);
 			
-			// check if there are any another messages waiting 
-			if (buf != NULL)
+			CAN_INDICATE_TX_TRAFFIC_FUNCTION;
+		}
+		else if ((CANSTMOB & (1 << RXOK)) == 0)
+		{
+			// error interrupt (only enabled in one-shot mode)
+			if ((CANCDMOB & ((1 << CONMOB1) | (1 << CONMOB0))) == (1 << CONMOB0))
 			{
-				at90can_copy_message_to_mob( buf );
-				can_buffer_dequeue(&can_tx_buffer);
+				// the transmission failed and is not repeated
+				_transmission_finished(mob);
+				_can_statistics.tx_failed++;
 				
-				// enable transmission
-				CANCDMOB |= (1<<CONMOB0);
+				CAN_INDICATE_TX_FAILED_FUNCTION;
 			}
 			else {
-				// buffer underflow => no more messages to send
-				_disable_mob_interrupt(mob);
-				_transmission_in_progress = 0;
+				CANSTMOB &= 0;
 			}
-			#else
-			_free_buffer++;
-			
-			// reset interrupt
-			if (mob < 8)
-				CANIE2 &= ~(1 << mob);
-			else
-				CANIE1 &= ~(1 << (mob - 8));
-			#endif
-			
-			CAN_INDICATE_TX_TRAFFIC_FUNCTION;
 		}
 		else {
 			// a message was received successfully
 			#if CAN_RX_BUFFER_SIZE > 0
-			can_t *buf = can_buffer_get_enqueue_ptr(&can_rx_buffer);
-			
-			if (buf != NULL)
-			{
-				// read message
-				at90can_copy_mob_to_message( buf );
-				
-				// push it to the list
-				can_buffer_enqueue(&can_rx_buffer);
-			}
-			else {
-				// buffer overflow => reject message
-				// FIXME inform the user
-			}
+			_store_message();
 			
 			// clear flags
 			CANSTMOB &= 0;
 			CANCDMOB = (1 << CONMOB1) | (CANCDMOB & (1 << IDE));
+			
+			#if CAN_RX_POLL_THRESHOLD > 0
+			if (++_rx_count >= CAN_RX_POLL_THRESHOLD) {
+				// heavy load => fetch the messages from can_rx_poll_tick()
+				CANGIE &= ~(1 << ENRX);
+			}
+			#endif
 			#else
 			_messages_waiting++;
 			
@@ -283,10 +470,21 @@ ISR(CANIT_vect)
 		// no MOb matches with the interrupt => general interrupt
 		CANGIT |= 0;
 	}
+	
+	#if CAN_FREERTOS
+	_can_freertos_isr_exit();
+	#endif
 }
 
 // ----------------------------------------------------------------------------
 // Overflow of CAN timer
+#if SUPPORT_TIMESTAMPS
+ISR(OVRIT_vect)
+{
+	_timer_overflows++;
+}
+#else
 ISR(OVRIT_vect) {}
+#endif
 
 #endif	// SUPPORT_FOR_AT90CAN__
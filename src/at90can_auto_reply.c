@@ -0,0 +1,95 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "at90can_private.h"
+#if defined(SUPPORT_FOR_AT90CAN__) && CAN_AUTO_REPLY_SLOTS > 0
+
+// ----------------------------------------------------------------------------
+// Configure a MOb to receive remote frames with the ID of the reply. With
+// RPLV set the hardware answers them by itself, the interrupt only has
+// to re-arm the MOb afterwards (see ISR(CANIT_vect)).
+
+bool at90can_set_auto_reply(uint8_t number, const can_t *msg)
+{
+	if (number >= CAN_AUTO_REPLY_SLOTS)
+		return false;
+	
+	uint8_t mob = AT90CAN_AUTO_REPLY_MOB + number;
+	
+	// set CAN Controller to standby mode
+	_enter_standby_mode();
+	
+	CANPAGE = mob << 4;
+	
+	CANSTMOB = 0;
+	CANCDMOB = 0;
+	
+	if (msg == NULL)
+	{
+		_disable_mob_interrupt(mob);
+	}
+	else
+	{
+		// ID, DLC and data of the reply
+		at90can_copy_message_to_mob( msg );
+		
+		// only accept remote frames with exactly this ID
+		#if SUPPORT_EXTENDED_CANID
+		if (msg->flags.extended)
+		{
+			CANIDM1 = 0xff;
+			CANIDM2 = 0xff;
+			CANIDM3 = 0xff;
+			CANIDM4 = 0xf8;
+		}
+		else
+		#endif
+		{
+			CANIDM1 = 0xff;
+			CANIDM2 = 0xe0;
+			CANIDM3 = 0;
+			CANIDM4 = 0;
+		}
+		
+		CANIDT4 |= (1 << RTRTAG);
+		CANIDM4 |= (1 << RTRMSK) | (1 << IDEMSK);
+		
+		CANCDMOB |= (1 << CONMOB1) | (1 << RPLV);
+		
+		_enable_mob_interrupt(mob);
+	}
+	
+	// re-enable CAN Controller 
+	_leave_standby_mode();
+	
+	return true;
+}
+
+#endif	// SUPPORT_FOR_AT90CAN__
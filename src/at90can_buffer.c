@@ -50,6 +50,8 @@ bool at90can_check_message(void)
 
 bool at90can_check_free_buffer(void)
 {
+	_release_one_shot_mobs();
+	
 	#if CAN_TX_BUFFER_SIZE == 0
 	// check if there is any free MOb
 	if (_free_buffer > 0)
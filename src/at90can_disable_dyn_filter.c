@@ -36,16 +36,22 @@
 
 bool at90can_disable_filter(uint8_t number)
 {
-	if (number > 14)
+	if (number >= AT90CAN_MOBS)
 	{
 		if (number == CAN_ALL_FILTER)
 		{
-			// disable interrupts
-			CANIE1 = 0;
-			CANIE2 = 0;
+			// disable interrupts, except for the automatic replies
+			CANIE1 = (AT90CAN_AUTO_REPLY_IE >> 8);
+			CANIE2 = (AT90CAN_AUTO_REPLY_IE & 0xff);
 			
 			// disable all MObs
 			for (uint8_t i = 0;i < 15;i++) {
+				#if CAN_AUTO_REPLY_SLOTS > 0
+				// the automatic replies are kept, see can_set_auto_reply()
+				if (i >= AT90CAN_AUTO_REPLY_MOB && i < AT90CAN_PERIODIC_MOB)
+					continue;
+				#endif
+				
 				CANPAGE = (i << 4);
 				
 				// disable MOb (read-write required)
@@ -59,13 +65,14 @@ bool at90can_disable_filter(uint8_t number)
 			#endif
 			
 			#if CAN_TX_BUFFER_SIZE == 0
-			_free_buffer = 15;
+			_free_buffer = AT90CAN_MOBS;
 			#endif
 			
 			return true;
 		}
 		
 		// it is only possible to serve a maximum of 15 filters
+		// (minus the MObs reserved for periodic messages)
 		return false;
 	}
 	
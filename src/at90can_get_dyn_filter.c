@@ -35,7 +35,7 @@
 
 uint8_t at90can_get_filter(uint8_t number, can_filter_t *filter)
 {
-	if (number > 14) {
+	if (number >= AT90CAN_MOBS) {
 		// it is only possible to serve a maximum of 15 filters
 		return 0;
 	}
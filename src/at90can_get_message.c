@@ -122,7 +122,7 @@ uint8_t at90can_get_message(can_t *msg)
 		return 0;
 	
 	// find the MOb with the received message
-	for (mob = 0; mob < 15; mob++)
+	for (mob = 0; mob < AT90CAN_MOBS; mob++)
 	{
 		CANPAGE = mob << 4;
 		
@@ -144,9 +144,9 @@ uint8_t at90can_get_message(can_t *msg)
 	
 	#if CAN_RX_BUFFER_SIZE == 0
 	// mark message as processed
-	ENTER_CRITICAL_SECTION;
+	CAN_ENTER_CRITICAL_SECTION;
 	_messages_waiting--;
-	LEAVE_CRITICAL_SECTION;
+	CAN_LEAVE_CRITICAL_SECTION;
 	#endif
 	
 	// re-enable interrupts
@@ -155,6 +155,20 @@ uint8_t at90can_get_message(can_t *msg)
 	// clear flags
 	CANCDMOB = (1 << CONMOB1) | (CANCDMOB & (1 << IDE));
 	
+	#if CAN_MAILBOX_SLOTS > 0
+	if (found && _can_mailbox_update(msg)) {
+		// message was stored in a mailbox
+		return 0;
+	}
+	#endif
+	
+	#if CAN_CHANGE_FILTER_SLOTS > 0
+	if (found && _can_suppress_unchanged(msg)) {
+		// content didn't change since the last message
+		return 0;
+	}
+	#endif
+	
 	if (found) {
 		return (mob + 1);
 	}
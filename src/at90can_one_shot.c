@@ -0,0 +1,54 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "at90can_private.h"
+#ifdef	SUPPORT_FOR_AT90CAN__
+
+// ----------------------------------------------------------------------------
+void at90can_set_one_shot(bool enable)
+{
+	_enter_standby_mode();
+	
+	// In the Time Triggered Communication mode every message is only
+	// sent once. Errors are reported through the MOb interrupt.
+	if (enable) {
+		CANGCON |= (1 << TTC);
+		CANGIE |= (1 << ENERR);
+	}
+	else {
+		CANGCON &= ~(1 << TTC);
+		CANGIE &= ~(1 << ENERR);
+	}
+	_one_shot_mode = enable;
+	
+	_leave_standby_mode();
+}
+
+#endif	// SUPPORT_FOR_AT90CAN__
@@ -0,0 +1,100 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "at90can_private.h"
+#if defined(SUPPORT_FOR_AT90CAN__) && CAN_PERIODIC_MOBS > 0
+
+// ----------------------------------------------------------------------------
+// Load a message into one of the reserved MObs. ID, DLC and the initial data
+// stay in the MOb, so a periodic transmission only has to refresh the
+// changed data bytes.
+
+bool at90can_set_periodic_message(uint8_t number, const can_t *msg)
+{
+	if (number >= CAN_PERIODIC_MOBS)
+		return false;
+	
+	CANPAGE = (AT90CAN_PERIODIC_MOB + number) << 4;
+	
+	// disable MOb and clear flags
+	CANCDMOB = 0;
+	CANSTMOB &= 0;
+	
+	// copy ID, DLC and data. CONMOB stays zero, so nothing is sent yet.
+	at90can_copy_message_to_mob( msg );
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// Send a message previously loaded with at90can_set_periodic_message().
+// Bit n of 'changed' marks that data[n] has to be updated before sending.
+
+bool at90can_send_periodic_message(uint8_t number, const uint8_t *data, uint8_t changed)
+{
+	if (number >= CAN_PERIODIC_MOBS)
+		return false;
+	
+	uint8_t mob = AT90CAN_PERIODIC_MOB + number;
+	
+	// check if the previous transmission is still pending
+	if (mob < 8) {
+		if (CANEN2 & (1 << mob))
+			return false;
+	}
+	else {
+		if (CANEN1 & (1 << (mob - 8)))
+			return false;
+	}
+	
+	uint8_t canpage = mob << 4;
+	CANPAGE = canpage;
+	
+	// clear flags
+	CANSTMOB &= 0;
+	
+	// refresh only the changed bytes
+	for (uint8_t i = 0; changed != 0; i++, changed >>= 1)
+	{
+		if (changed & 0x01) {
+			CANPAGE = canpage | i;
+			CANMSG = data[i];
+		}
+	}
+	
+	// enable transmission, the interrupt for this MOb is never enabled
+	CANCDMOB |= (1 << CONMOB0);
+	
+	CAN_INDICATE_TX_TRAFFIC_FUNCTION;
+	
+	return true;
+}
+
+#endif	// SUPPORT_FOR_AT90CAN__
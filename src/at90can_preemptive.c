@@ -0,0 +1,169 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "at90can_private.h"
+#ifdef	SUPPORT_FOR_AT90CAN__
+
+#include <util/delay.h>
+
+// ----------------------------------------------------------------------------
+uint8_t at90can_send_message_preemptive(const can_t *msg, can_t *aborted)
+{
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit(msg))
+		return 0;
+	#endif
+	
+	uint8_t mob = _find_free_mob();
+	if (mob < 15)
+		return at90can_start_transmission(msg);
+	
+	// All MObs are in use => search the pending message with the
+	// lowest priority. It is only replaced if the new message would
+	// win the arbitration against it.
+	uint32_t lowest = _can_arbitration_key(msg);
+	can_t tmp;
+	#if CAN_TX_BUFFER_SIZE > 0
+	bool queued = false;
+	#endif
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	for (uint8_t i = 0; i < AT90CAN_MOBS; i++)
+	{
+		CANPAGE = i << 4;
+		
+		// check if MOb is used for transmission
+		if ((CANCDMOB & ((1 << CONMOB1) | (1 << CONMOB0))) != (1 << CONMOB0))
+			continue;
+		
+		at90can_copy_mob_to_message(&tmp);
+		
+		uint32_t key = _can_arbitration_key(&tmp);
+		if (key > lowest) {
+			lowest = key;
+			mob = i;
+			*aborted = tmp;
+		}
+	}
+	
+	if (mob < 15) {
+		// the MOb is handled here from now on
+		_disable_mob_interrupt(mob);
+	}
+	#if CAN_TX_BUFFER_SIZE > 0
+	else if (_transmission_in_progress) {
+		// all pending messages have a higher priority => the new
+		// message will be the next one to be sent
+		#if CAN_TX_DEADLINE
+		tmp = *msg;
+		tmp.timestamp = 0;
+		queued = can_buffer_requeue(&can_tx_buffer, &tmp);
+		#else
+		queued = can_buffer_requeue(&can_tx_buffer, msg);
+		#endif
+	}
+	#endif
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	if (mob >= 15) {
+		#if CAN_TX_BUFFER_SIZE > 0
+		return (queued) ? 1 : 0;
+		#else
+		return 0;
+		#endif
+	}
+	
+	// Disable the MOb to abort the transmission. A message which is
+	// already on the bus can't be aborted, in this case wait until it
+	// was sent. This takes at most one frame, the same as for the MCP2515.
+	CANPAGE = mob << 4;
+	CANCDMOB &= ~((1 << CONMOB1) | (1 << CONMOB0));
+	
+	uint16_t i = 0;
+	while ((mob < 8) ? (CANEN2 & (1 << mob)) : (CANEN1 & (1 << (mob - 8))))
+	{
+		if (++i > 1000) {
+			// the transmission doesn't end (e.g. no acknowledge)
+			// => keep the old message
+			CANCDMOB |= (1 << CONMOB0);
+			_enable_mob_interrupt(mob);
+			return 0;
+		}
+		
+		_delay_us(20);
+	}
+	
+	uint8_t code = mob + 1;
+	uint8_t status = CANSTMOB;
+	
+	// the same bookkeeping as in the interrupt (TX timestamp)
+	_transmission_done(mob);
+	
+	if (status & (1 << TXOK))
+	{
+		CAN_INDICATE_TX_TRAFFIC_FUNCTION;
+	}
+	else if (_one_shot_mode && (status & ((1 << BERR) | (1 << SERR) |
+			(1 << CERR) | (1 << FERR) | (1 << AERR))))
+	{
+		// the transmission failed and is not repeated in one-shot mode
+		_can_statistics.tx_failed++;
+		
+		CAN_INDICATE_TX_FAILED_FUNCTION;
+	}
+	else
+	{
+		// message was aborted => send it again as soon as possible
+		#if CAN_TX_DEADLINE
+		// the deadline is lost when the message is loaded into the MOb
+		aborted->timestamp = 0;
+		#endif
+		
+		#if CAN_TX_BUFFER_SIZE > 0
+		if (!can_buffer_requeue(&can_tx_buffer, aborted))
+		#endif
+		{
+			code |= CAN_PREEMPTED;
+		}
+	}
+	
+	// reuse the MOb for the new message
+	CANSTMOB &= 0;
+	at90can_copy_message_to_mob(msg);
+	
+	_enable_mob_interrupt(mob);
+	
+	// enable transmission
+	CANCDMOB |= (1 << CONMOB0);
+	
+	return code;
+}
+
+#endif	// SUPPORT_FOR_AT90CAN__
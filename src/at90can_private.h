@@ -56,6 +56,28 @@
 
 #define	SUPPORT_FOR_AT90CAN__		1
 
+#if (CAN_PERIODIC_MOBS + CAN_AUTO_REPLY_SLOTS) > 14
+	#error	at least one MOb must remain for normal operation!
+#endif
+
+// ----------------------------------------------------------------------------
+// The MObs at the upper end are reserved for periodic messages, below them
+// are the MObs for automatic replies. All other MObs are available for
+// filters and normal transmissions.
+
+#define	AT90CAN_PERIODIC_MOB		(15 - CAN_PERIODIC_MOBS)
+#define	AT90CAN_AUTO_REPLY_MOB		(AT90CAN_PERIODIC_MOB - CAN_AUTO_REPLY_SLOTS)
+#define	AT90CAN_MOBS				AT90CAN_AUTO_REPLY_MOB
+
+// CANIE2:CANIE1 bits of the MObs for automatic replies
+#define	AT90CAN_AUTO_REPLY_IE		(((1 << CAN_AUTO_REPLY_SLOTS) - 1) << AT90CAN_AUTO_REPLY_MOB)
+
+// Prescaler of the CAN timer (CANTCON): f = F_CPU / 8 / (prescaler + 1),
+// e.g. 199 => 10 kHz, 1 => 1 MHz (at 16 MHz).
+#ifndef	AT90CAN_TIMER_PRESCALER
+	#define	AT90CAN_TIMER_PRESCALER		199
+#endif
+
 // ----------------------------------------------------------------------------
 
 #if CAN_RX_BUFFER_SIZE > 0
@@ -72,10 +94,36 @@ extern can_buffer_t can_tx_buffer;
 extern volatile uint8_t _free_buffer;
 #endif
 
-#if CAN_FORCE_TX_ORDER
-extern volatile uint8_t _transmission_in_progress ;
+#if CAN_TX_BUFFER_SIZE > 0
+// Number of MObs sending a message. Each of them loads the next message
+// from the buffer when its transmission is finished.
+extern volatile uint8_t _transmission_in_progress;
+#endif
+
+extern bool _one_shot_mode;
+
+#if CAN_RX_POLL_THRESHOLD > 0
+extern volatile uint8_t _rx_count;
+#endif
+
+#if SUPPORT_TIMESTAMPS
+extern volatile uint16_t _timer_overflows;
+extern volatile uint8_t _timestamp_mob;
+extern volatile uint16_t _tx_timestamp;
+extern volatile bool _tx_timestamp_valid;
 #endif
 
+// ----------------------------------------------------------------------------
+#if CAN_RX_BUFFER_SIZE > 0
+extern void _store_message(void);
+#endif
+
+// ----------------------------------------------------------------------------
+extern void _release_one_shot_mobs(void);
+
+// ----------------------------------------------------------------------------
+extern void _transmission_done(uint8_t mob);
+
 // ----------------------------------------------------------------------------
 extern uint8_t _find_free_mob(void);
 
@@ -89,6 +137,15 @@ extern void _enable_mob_interrupt(uint8_t mob);
 // ----------------------------------------------------------------------------
 extern uint8_t at90can_send_message(const can_t *msg);
 
+// ----------------------------------------------------------------------------
+// Same as at90can_send_message() without the rate limit, which has to be
+// checked by the caller.
+
+extern uint8_t at90can_start_transmission(const can_t *msg);
+
+// ----------------------------------------------------------------------------
+extern uint8_t at90can_send_message_deadline(const can_t *msg, uint16_t max_age);
+
 // ----------------------------------------------------------------------------
 extern uint8_t at90can_get_message(can_t *msg);
 
@@ -117,15 +174,15 @@ extern bool at90can_copy_mob_to_message(can_t *msg);
 
 extern __attribute__ ((gnu_inline)) inline void _enter_standby_mode(void)
 {
-	// request abort
-	CANGCON = (1 << ABRQ);
+	// request abort (one-shot mode stays selected)
+	CANGCON = (CANGCON & (1 << TTC)) | (1 << ABRQ);
 	
 	// wait until receiver is not busy
 	while (CANGSTA & (1 << RXBSY))
 		;
 	
 	// request standby mode
-	CANGCON = 0;
+	CANGCON &= (1 << TTC);
 	
 	// wait until the CAN Controller has entered standby mode
 	while (CANGSTA & (1 << ENFG))
@@ -140,8 +197,8 @@ extern __attribute__ ((gnu_inline)) inline void _leave_standby_mode(void)
 	// save CANPAGE register
 	uint8_t canpage = CANPAGE;
 	
-	// reenable all MObs
-	for (uint8_t i=0;i<15;i++) {
+	// reenable all MObs (pending periodic messages stay aborted)
+	for (uint8_t i=0;i<AT90CAN_PERIODIC_MOB;i++) {
 		CANPAGE = i << 4;
 		CANCDMOB = CANCDMOB;
 	}
@@ -150,7 +207,7 @@ extern __attribute__ ((gnu_inline)) inline void _leave_standby_mode(void)
 	CANPAGE = canpage;
 	
 	// request normal mode
-	CANGCON = (1 << ENASTB);
+	CANGCON = (CANGCON & (1 << TTC)) | (1 << ENASTB);
 	
 	// wait until the CAN Controller has left standby mode
 	while ((CANGSTA & (1 << ENFG)) == 0)
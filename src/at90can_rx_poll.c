@@ -0,0 +1,84 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "at90can_private.h"
+#if defined(SUPPORT_FOR_AT90CAN__) && CAN_RX_POLL_THRESHOLD > 0
+
+#include "can_buffer.h"
+
+// ----------------------------------------------------------------------------
+void at90can_rx_poll_tick(void)
+{
+	if (CANGIE & (1 << ENRX))
+	{
+		// interrupt mode => only start a new measurement
+		CAN_ENTER_CRITICAL_SECTION;
+		_rx_count = 0;
+		CAN_LEAVE_CRITICAL_SECTION;
+		
+		return;
+	}
+	
+	// polling mode => fetch all received messages
+	uint8_t count = 0;
+	
+	for (uint8_t mob = 0; mob < AT90CAN_MOBS; mob++)
+	{
+		CAN_ENTER_CRITICAL_SECTION;
+		uint8_t canpage = CANPAGE;
+		CANPAGE = mob << 4;
+		
+		if (CANSTMOB & (1 << RXOK))
+		{
+			_store_message();
+			
+			// clear flags
+			CANSTMOB &= 0;
+			CANCDMOB = (1 << CONMOB1) | (CANCDMOB & (1 << IDE));
+			
+			count++;
+			CAN_INDICATE_RX_TRAFFIC_FUNCTION;
+		}
+		
+		CANPAGE = canpage;
+		CAN_LEAVE_CRITICAL_SECTION;
+	}
+	
+	if (count < (CAN_RX_POLL_THRESHOLD + 1) / 2)
+	{
+		// load has decreased => back to interrupt mode
+		CAN_ENTER_CRITICAL_SECTION;
+		_rx_count = 0;
+		CANGIE |= (1 << ENRX);
+		CAN_LEAVE_CRITICAL_SECTION;
+	}
+}
+
+#endif	// SUPPORT_FOR_AT90CAN__
@@ -34,13 +34,33 @@
 #include <string.h>
 
 // -----------------------------------------------------------------------------
+#if CAN_TX_DEADLINE
+
+uint8_t at90can_send_buffered_message(const can_t *msg)
+{
+	return at90can_send_message_deadline(msg, 0);
+}
+
+// -----------------------------------------------------------------------------
+uint8_t at90can_send_message_deadline(const can_t *msg, uint16_t max_age)
+#else
 uint8_t at90can_send_buffered_message(const can_t *msg)
+#endif
 {
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit(msg))
+		return 0;
+	#endif
+	
+	_release_one_shot_mobs();
+	
 	// check if there is any free buffer left
 #if CAN_FORCE_TX_ORDER
 	if (_transmission_in_progress)
 #else
-	if (_find_free_mob() == 0xff)
+	// the message is only sent from the buffer if there is an ongoing
+	// transmission, otherwise all MObs are used for reception
+	if (_find_free_mob() == 0xff && _transmission_in_progress)
 #endif
 	{
 		can_t *buf = can_buffer_get_enqueue_ptr(&can_tx_buffer); 
@@ -48,9 +68,32 @@ uint8_t at90can_send_buffered_message(const can_t *msg)
 		if (buf == NULL)
 			return 0;		// buffer full
 		
+		#if CAN_SHED_HIGH_WATERMARK > 0
+		if (!can_buffer_accept(&can_tx_buffer, msg)) {
+			// buffer nearly full => reject low priority messages
+			_can_statistics.tx_shed++;
+			return 0;
+		}
+		#endif
+		
 		// copy message to the buffer
 		memcpy( buf, msg, sizeof(can_t) );
 		
+		#if CAN_TX_DEADLINE
+		// the timestamp of a buffered message holds its deadline
+		// (0 => no deadline)
+		buf->timestamp = 0;
+		if (max_age != 0)
+		{
+			CAN_ENTER_CRITICAL_SECTION;
+			buf->timestamp = CANTIM + max_age;
+			CAN_LEAVE_CRITICAL_SECTION;
+			
+			if (buf->timestamp == 0)
+				buf->timestamp = 1;
+		}
+		#endif
+		
 		// In the interrupt it is checked if there are any waiting messages
 		// in the queue, otherwise the interrupt will be disabled.
 		// So, if the transmission finished while we are in this routine the 
@@ -59,15 +102,21 @@ uint8_t at90can_send_buffered_message(const can_t *msg)
 		// to the queue.
 		bool enqueued = false;
 		
+		CAN_ENTER_CRITICAL_SECTION;
 #if CAN_FORCE_TX_ORDER
-		ENTER_CRITICAL_SECTION;
 		if (_transmission_in_progress)
+#else
+		if (_find_free_mob() == 0xff && _transmission_in_progress)
+#endif
 		{
+			#if CAN_TX_PRIORITY_QUEUE
+			can_buffer_enqueue_sorted(&can_tx_buffer);
+			#else
 			can_buffer_enqueue(&can_tx_buffer);
+			#endif
 			enqueued = true;
 		}
-		LEAVE_CRITICAL_SECTION;
-#endif
+		CAN_LEAVE_CRITICAL_SECTION;
 		
 		if (enqueued) {
 			return 1;
@@ -89,6 +89,17 @@ void at90can_copy_message_to_mob(const can_t *msg)
 
 // ----------------------------------------------------------------------------
 uint8_t at90can_send_message(const can_t *msg)
+{
+	#if CAN_RATE_LIMIT_CLASSES > 0 && CAN_TX_BUFFER_SIZE == 0
+	if (!_can_rate_limit(msg))
+		return 0;
+	#endif
+	
+	return at90can_start_transmission(msg);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t at90can_start_transmission(const can_t *msg)
 {
 	// check if there is any free MOb
 	uint8_t mob = _find_free_mob();
@@ -107,13 +118,13 @@ uint8_t at90can_send_message(const can_t *msg)
 	// enable interrupt
 	_enable_mob_interrupt(mob);
 	
-	ENTER_CRITICAL_SECTION;
+	CAN_ENTER_CRITICAL_SECTION;
 	#if CAN_TX_BUFFER_SIZE == 0
 		_free_buffer--;
-	#elif CAN_FORCE_TX_ORDER
-		_transmission_in_progress = 1;
+	#else
+		_transmission_in_progress++;
 	#endif
-	LEAVE_CRITICAL_SECTION;
+	CAN_LEAVE_CRITICAL_SECTION;
 	
 	// enable transmission
 	CANCDMOB |= (1<<CONMOB0);
@@ -34,7 +34,7 @@
 // ----------------------------------------------------------------------------
 bool at90can_set_filter(uint8_t number, const can_filter_t *filter)
 {
-	if (number > 14) {
+	if (number >= AT90CAN_MOBS) {
 		// it is only possible to serve a maximum of 15 filters
 		return false;
 	}
@@ -0,0 +1,124 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "at90can_private.h"
+#ifdef	SUPPORT_FOR_AT90CAN__
+
+// ----------------------------------------------------------------------------
+// header[0..3] are the values for CANIDT1 .. CANIDT4, header[4] is the value
+// for CANCDMOB without the CONMOB bits.
+
+void at90can_prepare_template(can_template_t *tpl, const can_t *msg)
+{
+	uint8_t cancdmob = msg->length & 0x0f;
+	if (cancdmob > 8)
+		cancdmob = 8;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if (msg->flags.extended)
+	{
+		cancdmob |= (1 << IDE);
+		
+		tpl->header[0] = msg->id >> 21;
+		tpl->header[1] = msg->id >> 13;
+		tpl->header[2] = msg->id >> 5;
+		tpl->header[3] = (uint8_t) msg->id << 3;
+	}
+	else
+	#endif
+	{
+		tpl->header[0] = (uint16_t) msg->id >> 3;
+		tpl->header[1] = (uint8_t)  msg->id << 5;
+		tpl->header[2] = 0;
+		tpl->header[3] = 0;
+	}
+	
+	if (msg->flags.rtr) {
+		tpl->header[3] |= (1 << RTRTAG);
+	}
+	
+	tpl->header[4] = cancdmob;
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	_can_rate_limit_prepare(tpl, msg);
+	#endif
+}
+
+// ----------------------------------------------------------------------------
+uint8_t at90can_send_template(const can_template_t *tpl, const uint8_t *data)
+{
+	// check if there is any free MOb
+	uint8_t mob = _find_free_mob();
+	if (mob >= 15)
+		return 0;
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit_template(tpl))
+		return 0;
+	#endif
+	
+	// load corresponding MOb page ...
+	CANPAGE = (mob << 4);
+	
+	// clear flags
+	CANSTMOB &= 0;
+	
+	// ... and copy the data
+	CANIDT1 = tpl->header[0];
+	CANIDT2 = tpl->header[1];
+	CANIDT3 = tpl->header[2];
+	CANIDT4 = tpl->header[3];
+	
+	if (!(tpl->header[3] & (1 << RTRTAG)))
+	{
+		uint8_t length = tpl->header[4] & 0x0f;
+		for (uint8_t i = 0;i < length;i++) {
+			CANMSG = *data++;
+		}
+	}
+	
+	// enable interrupt
+	_enable_mob_interrupt(mob);
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	#if CAN_TX_BUFFER_SIZE == 0
+		_free_buffer--;
+	#else
+		_transmission_in_progress++;
+	#endif
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	// write DLC and enable transmission
+	CANCDMOB = tpl->header[4] | (1<<CONMOB0);
+	
+	return (mob + 1);
+}
+
+#endif	// SUPPORT_FOR_AT90CAN__
@@ -0,0 +1,99 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "at90can_private.h"
+#if defined(SUPPORT_FOR_AT90CAN__) && SUPPORT_TIMESTAMPS
+
+// ----------------------------------------------------------------------------
+uint32_t at90can_get_time(void)
+{
+	uint16_t high;
+	uint16_t low;
+	
+	// the overflow interrupt is not masked by CAN_SCOPED_CRITICAL_SECTION
+	ENTER_CRITICAL_SECTION;
+	high = _timer_overflows;
+	low = CANTIM;
+	
+	// overflow happened but the interrupt didn't run yet
+	if ((CANGIT & (1 << OVRTIM)) && low < 0x8000)
+		high++;
+	LEAVE_CRITICAL_SECTION;
+	
+	return ((uint32_t) high << 16) | low;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t at90can_send_timestamped_message(const can_t *msg)
+{
+	uint8_t mob = 0;
+	
+	// the MOb has to be stored before the interrupt of the finished
+	// transmission may occur
+	CAN_ENTER_CRITICAL_SECTION;
+	#if CAN_TX_BUFFER_SIZE > 0 && CAN_FORCE_TX_ORDER
+	// the message must not overtake the buffered messages
+	if (_timestamp_mob == 0xff && !_transmission_in_progress)
+	#else
+	if (_timestamp_mob == 0xff)
+	#endif
+	{
+		#if CAN_RATE_LIMIT_CLASSES > 0
+		if (_can_rate_limit(msg))
+		#endif
+			mob = at90can_start_transmission(msg);
+		
+		if (mob != 0) {
+			_timestamp_mob = mob - 1;
+			_tx_timestamp_valid = false;
+		}
+	}
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	return mob;
+}
+
+// ----------------------------------------------------------------------------
+bool at90can_get_tx_timestamp(uint16_t *timestamp)
+{
+	bool valid;
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	valid = _tx_timestamp_valid;
+	if (valid) {
+		*timestamp = _tx_timestamp;
+		_tx_timestamp_valid = false;
+	}
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	return valid;
+}
+
+#endif	// SUPPORT_FOR_AT90CAN__
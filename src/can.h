@@ -70,6 +70,10 @@
 //@{
 #define	ONLY_NON_RTR		2
 #define	ONLY_RTR			3
+
+/// Set in the return value of can_send_message_preemptive() if a pending
+/// message was aborted and copied to the caller
+#define	CAN_PREEMPTED		0x80
 //@}
 
 /** \ingroup	can_interface
@@ -109,6 +113,16 @@ typedef enum {
 	#define	SUPPORT_TIMESTAMPS		0
 #endif
 
+/**
+ * \ingroup     can_interface
+ * \brief		CAN FD messages with up to 64 data bytes
+ * \warning     Only supported by the MCP2517FD/MCP2518FD, the other
+ *				controllers still send and receive only 8 bytes.
+ */
+#ifndef	SUPPORT_CAN_FD
+	#define	SUPPORT_CAN_FD			0
+#endif
+
 /**
  * \ingroup	    can_interface
  * \name		Bits des Filters fuer den MCP2515 umformatieren
@@ -176,22 +190,72 @@ typedef struct
 		struct {
 			int rtr : 1;			//!< Remote-Transmit-Request-Frame?
 			int extended : 1;		//!< extended ID?
+			#if SUPPORT_CAN_FD
+			int fd : 1;				//!< CAN FD frame?
+			int brs : 1;			//!< data phase with the higher bit rate?
+			#endif
 		} flags;
 	#else
 		uint16_t id;				//!< ID der Nachricht (11 Bit)
 		struct {
 			int rtr : 1;			//!< Remote-Transmit-Request-Frame?
+			#if SUPPORT_CAN_FD
+			int fd : 1;				//!< CAN FD frame?
+			int brs : 1;			//!< data phase with the higher bit rate?
+			#endif
 		} flags;
 	#endif
 	
 	uint8_t length;				//!< Anzahl der Datenbytes
-	uint8_t data[8];			//!< Die Daten der CAN Nachricht
+	#if SUPPORT_CAN_FD
+		/// CAN FD: 0..8, 12, 16, 20, 24, 32, 48 or 64 bytes, other lengths
+		/// are padded with zeros to the next valid length
+		uint8_t data[64];
+	#else
+		uint8_t data[8];		//!< Die Daten der CAN Nachricht
+	#endif
 	
 	#if SUPPORT_TIMESTAMPS
 		uint16_t timestamp;
 	#endif
 } can_t;
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Pre-encoded header of a message
+ *
+ * Holds ID, DLC and RTR-flag of a message already converted to the
+ * register format of the CAN controller:
+ *
+ * \code
+ *  controller | header[0..4]
+ * ------------|------------------------------
+ *  MCP2515    | SIDH, SIDL, EID8, EID0, DLC
+ *  SJA1000    | frame info, ID1 .. ID4
+ *  AT90CAN    | CANIDT1 .. CANIDT4, CANCDMOB
+ * \endcode
+ *
+ * \see	can_prepare_template(), can_send_template()
+ */
+typedef struct
+{
+	uint8_t header[5];
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	// ID and flags for the rate limit
+	#if SUPPORT_EXTENDED_CANID
+	uint32_t id;
+	#else
+	uint16_t id;
+	#endif
+	uint8_t rtr : 1;
+	uint8_t extended : 1;
+	#endif
+} can_template_t;
+
 
 
 // ----------------------------------------------------------------------------
@@ -254,6 +318,27 @@ typedef struct {
 	uint8_t tx;				//!< Sende-Register
 } can_error_register_t;
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup can_interface
+ *
+ * \~english
+ * \brief	Counters of messages discarded by the library
+ *
+ * \see	can_read_statistics()
+ */
+typedef struct {
+	uint16_t tx_expired;	//!< queued messages dropped after their deadline
+	uint16_t tx_failed;		//!< failed transmissions in one-shot mode
+	uint16_t tx_rate_limited;	//!< messages rejected by the rate limit
+	uint8_t rate_limited_classes;	//!< bit n set => class n hit its limit
+	uint16_t tx_shed;		//!< messages rejected by the overload protection
+	uint16_t rx_shed;		//!< messages dropped by the overload protection
+	uint16_t rx_overflow;	//!< messages lost because the receive buffer was full
+	uint16_t rx_unchanged;	//!< repetitions dropped by the change filters
+	uint16_t lock_max;		//!< longest critical section in ticks of CAN_LOCK_TIMER
+} can_statistics_t;
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup can_interface
@@ -436,6 +521,26 @@ can_get_filter(uint8_t number, can_filter_t *filter);
 extern bool
 can_check_message(void);
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Sleep until a message was received
+ *
+ * Waits for the falling edge of the INT pin if MCP2515_INT_GPIO is given,
+ * otherwise the MCP2515 is polled every millisecond. With CAN_FREERTOS the
+ * task blocks on a semaphore given by the receive interrupt.
+ *
+ * \param	timeout	in milliseconds, a negative value waits forever
+ * \return	true if a message is available, false after the timeout
+ *
+ * \warning	Only available for the MCP2515 with SPI_SPIDEV (Linux) and
+ *			with CAN_FREERTOS.
+ */
+extern bool
+can_wait_message(int16_t timeout);
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup	can_interface
@@ -458,6 +563,129 @@ can_check_free_buffer(void);
 extern uint8_t
 can_send_message(const can_t *msg);
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Send a message which is only valid for a limited time
+ *
+ * Like can_send_message(), but if the message has to wait in the transmit
+ * buffer for longer than \a max_age it is discarded instead of being sent.
+ * Discarded messages are counted in can_statistics_t::tx_expired.
+ *
+ * \param	msg		Message to be sent
+ * \param	max_age	Maximal time in the transmit buffer in ticks of the
+ *					CAN timer (0.1 ms at 16 MHz with the default
+ *					AT90CAN_TIMER_PRESCALER), must be less than 0x8000.
+ *					0 means no limit.
+ * \return	FALSE if the message could not be sent, otherwise the code of
+ *			the buffer used for the message
+ *
+ * \warning	Only supported by the AT90CAN, needs CAN_TX_DEADLINE,
+ *			SUPPORT_TIMESTAMPS and CAN_TX_BUFFER_SIZE > 0.
+ */
+extern uint8_t
+can_send_message_deadline(const can_t *msg, uint16_t max_age);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Send a message where only the latest value is of interest
+ *
+ * If a message with the same identifier is still waiting in the transmit
+ * buffer its data is overwritten with the data of \a msg instead of
+ * queueing another copy. Otherwise the same as can_send_message().
+ *
+ * \param	msg	Message to be sent
+ * \return	FALSE if the message could not be sent, otherwise the code of
+ *			the buffer used for the message
+ *
+ * \warning	Only supported by the AT90CAN. Without a transmit buffer
+ *			(CAN_TX_BUFFER_SIZE == 0) this is the same as can_send_message().
+ */
+extern uint8_t
+can_send_latest_message(const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Send an urgent message even if all transmit buffers are in use
+ *
+ * Works like can_send_message() if a buffer is free. Otherwise the pending
+ * message with the lowest priority is aborted and replaced by \a msg, as
+ * long as \a msg would win the arbitration against it. A message which is
+ * already on the bus is not interrupted, so the delay for \a msg is
+ * limited to the duration of one frame.
+ *
+ * On the AT90CAN the aborted message is put back to the front of the
+ * transmit buffer (if CAN_TX_BUFFER_SIZE > 0). Otherwise it is copied to
+ * \a aborted and CAN_PREEMPTED is set in the return value, the caller is
+ * responsible to send it again.
+ *
+ * \param	msg		Message to be sent
+ * \param	aborted	Receives the aborted message
+ * \return	FALSE if the message could not be sent, otherwise the code of
+ *			the buffer used for the message, combined with CAN_PREEMPTED
+ *			if \a aborted was filled.
+ *
+ * \warning	Not supported by the SJA1000.
+ */
+extern uint8_t
+can_send_message_preemptive(const can_t *msg, can_t *aborted);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Encode the header of a message for repeated transmission
+ *
+ * Converts ID, DLC and RTR-flag of \a msg once into the register format
+ * of the CAN controller. The data of \a msg is ignored, a length above 8
+ * is limited to 8.
+ *
+ * \param	tpl		Template to be filled
+ * \param	msg		Message with the ID, length and flags to be used
+ *
+ * \see	can_send_template()
+ */
+extern void
+can_prepare_template(can_template_t *tpl, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Send a message with a pre-encoded header
+ *
+ * Works like can_send_message() but skips the encoding of the identifier.
+ * Only the header bytes of the template and the payload are transferred
+ * to the CAN controller.
+ *
+ * \code
+ * can_template_t tpl;
+ * can_prepare_template(&tpl, &msg);
+ * ...
+ * can_send_template(&tpl, data);
+ * \endcode
+ *
+ * \param	tpl		Template created by can_prepare_template()
+ * \param	data	Payload, the length is taken from the template
+ * \return	FALSE if the message could not be sent, otherwise the code of
+ *			the buffer used for the message
+ *
+ * \warning	On the AT90CAN the message is never stored in the software
+ *			transmit buffer, 0 is returned if no MOb is free.
+ */
+extern uint8_t
+can_send_template(const can_template_t *tpl, const uint8_t *data);
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup	can_interface
@@ -466,10 +694,221 @@ can_send_message(const can_t *msg);
  * \param	msg	Pointer auf die Nachricht die gelesen werden soll.
  * \return	FALSE falls die Nachricht nicht ausgelesen konnte,
  *			ansonsten Filtercode welcher die Nachricht akzeptiert hat.
+ *
+ * \~english
+ * \note	If MCP2515_INT_VECTOR is defined the messages are read by the
+ *			interrupt and this function only takes them from the receive
+ *			buffer. The filter code is not available then, 0xff is returned.
  */
 extern uint8_t
 can_get_message(can_t *msg);
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Wait for a message and read it
+ *
+ * The calling task sleeps until the receive interrupt stores a message,
+ * several tasks may wait at the same time.
+ *
+ * \param	msg		Receives the message
+ * \param	timeout	in milliseconds, a negative value waits forever
+ * \return	0 after the timeout, otherwise see can_get_message()
+ *
+ * \warning	Only available with CAN_FREERTOS
+ */
+extern uint8_t
+can_get_message_timeout(can_t *msg, int16_t timeout);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Switch between interrupt and polling for received messages
+ *
+ * Has to be called periodically (e.g. every millisecond from a timer) if
+ * CAN_RX_POLL_THRESHOLD is set. As long as less than CAN_RX_POLL_THRESHOLD
+ * messages are received between two calls, every message is fetched by
+ * the interrupt. Above this rate the receive interrupt is disabled and
+ * all messages are fetched in one go by this function, saving the
+ * overhead of the interrupt for every single message. Interrupts are
+ * enabled again when less than half of the threshold is received per tick.
+ *
+ * With CAN_SCOPED_CRITICAL_SECTION this function has to be called from the
+ * main loop and not from an interrupt.
+ *
+ * \warning	Only supported by the AT90CAN
+ */
+extern void
+can_rx_poll_tick(void);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Subscribe a mailbox to an identifier
+ *
+ * A mailbox only holds the latest message accepted by its filter. These
+ * messages are not stored in the receive buffer and are not returned by
+ * can_get_message() anymore. Instead the application reads the current
+ * value with can_get_mailbox() whenever it needs it.
+ *
+ * On the AT90CAN with CAN_RX_BUFFER_SIZE > 0 and on the MCP2515 with
+ * MCP2515_INT_VECTOR the mailboxes are updated by the interrupt. Otherwise
+ * they are updated by can_get_message() which has to be called as usual.
+ *
+ * \param	number	Number of the mailbox (0 .. CAN_MAILBOX_SLOTS-1)
+ * \param	filter	Messages to be stored, NULL disables the mailbox
+ * \return	false if \a number is invalid, true otherwise
+ */
+extern bool
+can_set_mailbox(uint8_t number, const can_filter_t *filter);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Read the latest message of a mailbox
+ *
+ * \code
+ * static uint8_t last;
+ * uint8_t seq = can_get_mailbox(0, &msg);
+ * if (seq != 0 && seq != last) {
+ *     // new value received
+ *     last = seq;
+ * }
+ * \endcode
+ *
+ * \param	number	Number of the mailbox
+ * \param	msg		Receives the message (including its timestamp if
+ *					SUPPORT_TIMESTAMPS is enabled)
+ * \return	0 if no message was received yet, otherwise a sequence number
+ *			which is incremented for every received message (1..255)
+ */
+extern uint8_t
+can_get_mailbox(uint8_t number, can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Create the mutex, the semaphore and the queues of the FreeRTOS port
+ *
+ * Has to be called before can_init(), the scheduler may already be running.
+ *
+ * \return	false if FreeRTOS is out of memory
+ *
+ * \warning	Only available with CAN_FREERTOS
+ */
+extern bool
+can_freertos_init(void);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Get exclusive access to the CAN controller
+ *
+ * Every function which accesses the CAN controller or the receive buffer
+ * (sending, can_get_message(), filters, mode, ...) does this by itself,
+ * so any number of tasks may use them. Sequences of calls which must not
+ * be interrupted by another task (e.g. changing the mode and the filters)
+ * have to be enclosed by can_lock() and can_unlock(). The lock is
+ * recursive.
+ *
+ * \warning	Only available with CAN_FREERTOS, not from interrupts
+ */
+extern void
+can_lock(void);
+
+extern void
+can_unlock(void);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Subscribe a queue to an identifier
+ *
+ * Messages accepted by \a filter are put into a queue of
+ * CAN_SUBSCRIPTION_QUEUE_SIZE messages by the receive interrupt instead of
+ * the receive buffer. This way every task can wait for its own messages
+ * with can_get_subscribed_message(). Messages arriving while the queue
+ * is full are counted as rx_overflow.
+ *
+ * Mailboxes take precedence over subscriptions.
+ *
+ * \param	number	Number of the subscription (0 .. CAN_SUBSCRIPTION_SLOTS-1)
+ * \param	filter	Messages to be queued, NULL disables the subscription
+ * \return	false if \a number is invalid, true otherwise
+ *
+ * \warning	Only available with CAN_FREERTOS
+ */
+extern bool
+can_set_subscription(uint8_t number, const can_filter_t *filter);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Wait for a message of a subscription
+ *
+ * \param	number	Number of the subscription
+ * \param	msg		Receives the message
+ * \param	timeout	in milliseconds, a negative value waits forever
+ * \return	false after the timeout
+ */
+extern bool
+can_get_subscribed_message(uint8_t number, can_t *msg, int16_t timeout);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Deliver messages only if their content has changed
+ *
+ * A message accepted by \a filter is dropped if ID, length and data are
+ * the same as for the last delivered message of this filter. After
+ * \a refresh calls of can_change_filter_tick() the next message is
+ * delivered anyway. Dropped messages are counted in
+ * can_statistics_t::rx_unchanged.
+ *
+ * Every filter remembers only one message, so it should accept a
+ * single identifier.
+ *
+ * \param	number	Number of the filter (0 .. CAN_CHANGE_FILTER_SLOTS-1)
+ * \param	filter	Messages to be checked, NULL disables the filter
+ * \param	refresh	Refresh timeout in ticks, 0 => only changed messages
+ *					are delivered
+ * \return	false if \a number is invalid, true otherwise
+ */
+extern bool
+can_set_change_filter(uint8_t number, const can_filter_t *filter, uint8_t refresh);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Advance the refresh timeouts of the change filters
+ *
+ * Has to be called periodically if a refresh timeout is used.
+ *
+ * \see	can_set_change_filter()
+ */
+extern void
+can_change_filter_tick(void);
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup	can_interface
@@ -483,6 +922,18 @@ can_get_message(can_t *msg);
 extern can_error_register_t
 can_read_error_register(void);
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Reads the counters of discarded messages
+ *
+ * \param	reset	Clear the counters after reading
+ */
+extern can_statistics_t
+can_read_statistics(bool reset);
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup can_interface
@@ -520,6 +971,214 @@ can_reset_bus_off(void);
 extern void
 can_set_mode(can_mode_t mode);
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Limit the transmit rate of a class of identifiers
+ *
+ * Every class has a bucket with up to \a burst tokens which is refilled
+ * by \a rate tokens on each call of can_rate_limit_tick(). Sending a
+ * message takes a token from the first class whose filter accepts it. If
+ * the bucket is empty can_send_message() returns 0 and the message is
+ * counted in can_statistics_t::tx_rate_limited. Messages which don't
+ * belong to any class are not limited.
+ *
+ * \code
+ * // at most 10 messages with the IDs 0x100..0x1ff per 100 ms
+ * can_filter_t filter = { .id = 0x100, .mask = 0x700 };
+ * can_set_rate_limit(0, &filter, 1, 10);
+ * ...
+ * // every 10 ms
+ * can_rate_limit_tick();
+ * \endcode
+ *
+ * \param	number	Number of the class (0 .. CAN_RATE_LIMIT_CLASSES-1)
+ * \param	filter	IDs belonging to the class, NULL removes the limit
+ * \param	rate	Tokens added per tick
+ * \param	burst	Maximum number of tokens
+ * \return	false if \a number is invalid, true otherwise
+ *
+ * \warning	Messages sent by can_send_periodic_message() are not limited.
+ */
+extern bool
+can_set_rate_limit(uint8_t number, const can_filter_t *filter, uint8_t rate, uint8_t burst);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Refill the buckets of the rate limits
+ *
+ * Has to be called periodically, e.g. from a timer interrupt.
+ *
+ * \see	can_set_rate_limit()
+ */
+extern void
+can_rate_limit_tick(void);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Send every message only once
+ *
+ * In one-shot mode a message which loses the arbitration or is destroyed
+ * by an error is not retransmitted. Failed transmissions are counted in
+ * can_statistics_t::tx_failed and reported by calling
+ * CAN_INDICATE_TX_FAILED_FUNCTION.
+ *
+ * The AT90CAN detects errors in the interrupt. A lost arbitration (on the
+ * AT90CAN) and all failures on the MCP2515 and SJA1000 are detected when
+ * the transmit buffers are checked again, e.g. by can_check_free_buffer()
+ * or can_send_message().
+ *
+ * \param	enable	true to enable one-shot mode, false for automatic
+ *					retransmission (default)
+ *
+ * \warning	On the AT90CAN the controller enters standby mode for the
+ *			change, pending transmissions are aborted.
+ */
+extern void
+can_set_one_shot(bool enable);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Load a message into a MOb reserved for periodic transmission
+ *
+ * ID, DLC and data are kept in the MOb. Sending the message with
+ * can_send_periodic_message() afterwards only needs to refresh the data
+ * bytes which have changed. A pending transmission of the MOb is aborted.
+ *
+ * \code
+ * can_set_periodic_message(0, &msg);
+ * ...
+ * // every period: msg.data[2] has changed
+ * can_send_periodic_message(0, msg.data, (1 << 2));
+ * \endcode
+ *
+ * \param	number	Number of the periodic message (0 .. CAN_PERIODIC_MOBS-1)
+ * \param	msg		Message to be loaded
+ * \return	false if \a number is invalid, true otherwise
+ *
+ * \warning	Only supported by the AT90CAN. can_disable_filter(CAN_ALL_FILTER)
+ *			clears the periodic messages, too.
+ */
+extern bool
+can_set_periodic_message(uint8_t number, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Send a periodic message
+ *
+ * \param	number	Number of the periodic message
+ * \param	data	New data, only read for bytes marked in \a changed
+ * \param	changed	Bit n set => data[n] is written to the MOb
+ * \return	false if the previous transmission of this message is still
+ *			pending, true otherwise
+ *
+ * \warning	Only supported by the AT90CAN
+ */
+extern bool
+can_send_periodic_message(uint8_t number, const uint8_t *data, uint8_t changed);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Answer remote frames automatically
+ *
+ * A remote frame with the same identifier as \a msg is answered with
+ * the data of \a msg. Answered remote frames are not passed to the
+ * application.
+ *
+ * The AT90CAN uses the automatic reply of a MOb (RPLV), the reply is
+ * sent by the hardware. With MCP2515_INT_VECTOR the reply is sent by the
+ * interrupt, TXB2 is reserved for it and can_send_message() only uses
+ * TXB0 and TXB1. In all other cases (SJA1000, MCP2517FD, MCP2515 without
+ * MCP2515_INT_VECTOR) the reply is sent from within can_get_message(), so
+ * the application has to call it regularly to keep the latency small.
+ *
+ * can_disable_filter(CAN_ALL_FILTER) does not clear the replies.
+ *
+ * Call the function again to update the data of the reply.
+ *
+ * \param	number	Number of the reply (0 .. CAN_AUTO_REPLY_SLOTS-1)
+ * \param	msg		Reply to be sent, NULL disables the slot
+ * \return	false if \a number is invalid, true otherwise
+ */
+extern bool
+can_set_auto_reply(uint8_t number, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Read the CAN timer extended to 32 bit
+ *
+ * The lower 16 bit are the same as the timestamps of the messages, the
+ * upper 16 bit count the overflows of the timer. The resolution is set
+ * by AT90CAN_TIMER_PRESCALER.
+ *
+ * \warning	Only supported by the AT90CAN, needs SUPPORT_TIMESTAMPS
+ */
+extern uint32_t
+can_get_time(void);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Send a message and record the time of its transmission
+ *
+ * When the message was sent successfully the time is available from
+ * can_get_tx_timestamp(). It uses the same timer as the timestamps of
+ * received messages, so the time of a frame can be compared between the
+ * sender and the receivers (see can_timesync.h).
+ *
+ * Only one timestamped message can be pending at a time. On the AT90CAN
+ * with CAN_FORCE_TX_ORDER the message isn't accepted until the transmit
+ * buffer is empty.
+ *
+ * \return	FALSE if the message could not be sent, otherwise the code of
+ *			the buffer used for the message
+ *
+ * \warning	Only supported by the AT90CAN and the MCP2515 with
+ *			MCP2515_INT_VECTOR, needs SUPPORT_TIMESTAMPS. Don't use
+ *			it in one-shot mode on the MCP2515.
+ */
+extern uint8_t
+can_send_timestamped_message(const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~english
+ * \brief	Get the time of the last message sent by can_send_timestamped_message()
+ *
+ * The AT90CAN takes the time of the end of frame from the MOb (CANSTM),
+ * the MCP2515 the value of MCP2515_TIMESTAMP when its interrupt occurred.
+ *
+ * \param	timestamp	Receives the time
+ * \return	true if a new timestamp is available, every timestamp is
+ *			returned only once
+ */
+extern bool
+can_get_tx_timestamp(uint16_t *timestamp);
+
 #if defined (__cplusplus)
 }
 #endif
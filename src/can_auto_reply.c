@@ -0,0 +1,92 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_private.h"
+#include "utils.h"
+
+#if CAN_AUTO_REPLY_SLOTS > 0 && !BUILD_FOR_AT90CAN
+
+#if CAN_AUTO_REPLY_SLOTS > 8
+	#error	only up to 8 automatic replies are supported!
+#endif
+
+static can_t _can_auto_reply_list[CAN_AUTO_REPLY_SLOTS];
+static uint8_t _can_auto_reply_valid;
+
+// ----------------------------------------------------------------------------
+bool can_set_auto_reply(uint8_t number, const can_t *msg)
+{
+	if (number >= CAN_AUTO_REPLY_SLOTS)
+		return false;
+	
+	uint8_t mask = (1 << number);
+	
+	// disable the slot while it is changed
+	ENTER_CRITICAL_SECTION;
+	_can_auto_reply_valid &= ~mask;
+	LEAVE_CRITICAL_SECTION;
+	
+	if (msg != NULL)
+	{
+		_can_auto_reply_list[number] = *msg;
+		_can_auto_reply_list[number].flags.rtr = 0;
+		
+		ENTER_CRITICAL_SECTION;
+		_can_auto_reply_valid |= mask;
+		LEAVE_CRITICAL_SECTION;
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+bool _can_auto_reply(const can_t *msg)
+{
+	const can_t *reply = _can_auto_reply_list;
+	
+	for (uint8_t i = 0; i < CAN_AUTO_REPLY_SLOTS; i++, reply++)
+	{
+		if (!(_can_auto_reply_valid & (1 << i)))
+			continue;
+		
+		#if SUPPORT_EXTENDED_CANID
+		if (reply->id == msg->id && reply->flags.extended == msg->flags.extended)
+		#else
+		if (reply->id == msg->id)
+		#endif
+		{
+			return _CAN_AUTO_REPLY_SEND(reply);
+		}
+	}
+	
+	return false;
+}
+
+#endif
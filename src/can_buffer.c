@@ -28,6 +28,8 @@
  */
 // -----------------------------------------------------------------------------
 
+#include <string.h>
+
 #include "can_private.h"
 #include "can_buffer.h"
 #include "utils.h"
@@ -37,14 +39,16 @@
 // -----------------------------------------------------------------------------
 void can_buffer_init(can_buffer_t *buf, uint8_t size, can_t *list)
 {
-	ENTER_CRITICAL_SECTION;
+	CAN_ENTER_CRITICAL_SECTION;
 	buf->size = size;
 	buf->buf = list;
 	
 	buf->head = 0;
 	buf->tail = 0;
 	buf->used = 0;
-	LEAVE_CRITICAL_SECTION;
+	
+	buf->shedding = false;
+	CAN_LEAVE_CRITICAL_SECTION;
 }
 
 // -----------------------------------------------------------------------------
@@ -52,9 +56,9 @@ bool can_buffer_empty(can_buffer_t *buf)
 {
 	uint8_t used;
 	
-	ENTER_CRITICAL_SECTION;
+	CAN_ENTER_CRITICAL_SECTION;
 	used = buf->used;
-	LEAVE_CRITICAL_SECTION;
+	CAN_LEAVE_CRITICAL_SECTION;
 	
 	if (used == 0)
 		return true;
@@ -68,10 +72,10 @@ bool can_buffer_full(can_buffer_t *buf)
 	uint8_t used;
 	uint8_t size;
 	
-	ENTER_CRITICAL_SECTION;
+	CAN_ENTER_CRITICAL_SECTION;
 	used = buf->used;
 	size = buf->size;
-	LEAVE_CRITICAL_SECTION;
+	CAN_LEAVE_CRITICAL_SECTION;
 	
 	if (used >= size)
 		return true;
@@ -91,13 +95,152 @@ can_t *can_buffer_get_enqueue_ptr(can_buffer_t *buf)
 // -----------------------------------------------------------------------------
 void can_buffer_enqueue(can_buffer_t *buf)
 {
-	ENTER_CRITICAL_SECTION;
+	CAN_ENTER_CRITICAL_SECTION;
+	buf->used ++;
+	if (++buf->head >= buf->size)
+		buf->head = 0;
+	CAN_LEAVE_CRITICAL_SECTION;
+}
+
+// -----------------------------------------------------------------------------
+#if CAN_TX_PRIORITY_QUEUE
+
+void can_buffer_enqueue_sorted(can_buffer_t *buf)
+{
+	CAN_ENTER_CRITICAL_SECTION;
+	uint8_t pos = buf->head;
+	can_t msg = buf->buf[pos];
+	uint32_t key = _can_arbitration_key(&msg);
+	
+	// move all messages with a lower priority one position back
+	for (uint8_t i = buf->used; i > 0; i--)
+	{
+		uint8_t prev = (pos == 0) ? (buf->size - 1) : (pos - 1);
+		
+		if (_can_arbitration_key(&buf->buf[prev]) <= key)
+			break;
+		
+		buf->buf[pos] = buf->buf[prev];
+		pos = prev;
+	}
+	buf->buf[pos] = msg;
+	
 	buf->used ++;
 	if (++buf->head >= buf->size)
 		buf->head = 0;
-	LEAVE_CRITICAL_SECTION;
+	CAN_LEAVE_CRITICAL_SECTION;
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+bool can_buffer_requeue(can_buffer_t *buf, const can_t *msg)
+{
+	bool result = false;
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	if (buf->used < buf->size)
+	{
+		if (buf->tail == 0)
+			buf->tail = buf->size;
+		buf->tail--;
+		
+		uint8_t pos = buf->tail;
+		
+		#if CAN_TX_PRIORITY_QUEUE
+		uint32_t key = _can_arbitration_key(msg);
+		
+		// move all messages with a higher priority one position forward
+		for (uint8_t i = buf->used; i > 0; i--)
+		{
+			uint8_t next = (pos + 1 >= buf->size) ? 0 : (pos + 1);
+			
+			if (_can_arbitration_key(&buf->buf[next]) >= key)
+				break;
+			
+			buf->buf[pos] = buf->buf[next];
+			pos = next;
+		}
+		#endif
+		
+		buf->buf[pos] = *msg;
+		buf->used ++;
+		result = true;
+	}
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+bool can_buffer_replace(can_buffer_t *buf, const can_t *msg)
+{
+	bool result = false;
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	uint8_t pos = buf->tail;
+	for (uint8_t i = buf->used; i > 0; i--)
+	{
+		can_t *entry = &buf->buf[pos];
+		
+		if (entry->id == msg->id &&
+			#if SUPPORT_EXTENDED_CANID
+			entry->flags.extended == msg->flags.extended &&
+			#endif
+			entry->flags.rtr == msg->flags.rtr)
+		{
+			// overwrite the outdated payload
+			entry->length = msg->length;
+			memcpy(entry->data, msg->data, 8);
+			
+			#if CAN_TX_DEADLINE
+			// the deadline of the old message doesn't apply to the new data
+			entry->timestamp = 0;
+			#endif
+			
+			result = true;
+			break;
+		}
+		
+		if (++pos >= buf->size)
+			pos = 0;
+	}
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+#if CAN_SHED_HIGH_WATERMARK > 0
+
+bool can_buffer_accept(can_buffer_t *buf, const can_t *msg)
+{
+	bool result = true;
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	if (buf->used >= CAN_SHED_HIGH_WATERMARK)
+		buf->shedding = true;
+	else if (buf->used <= CAN_SHED_LOW_WATERMARK)
+		buf->shedding = false;
+	
+	if (buf->shedding)
+	{
+		uint16_t id = msg->id;
+		#if SUPPORT_EXTENDED_CANID
+		if (msg->flags.extended)
+			id = msg->id >> 18;
+		#endif
+		
+		if (id >= CAN_SHED_PRIORITY_ID)
+			result = false;
+	}
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	return result;
 }
 
+#endif
+
 // -----------------------------------------------------------------------------
 can_t *can_buffer_get_dequeue_ptr(can_buffer_t *buf)
 {
@@ -110,11 +253,11 @@ can_t *can_buffer_get_dequeue_ptr(can_buffer_t *buf)
 // -----------------------------------------------------------------------------
 void can_buffer_dequeue(can_buffer_t *buf)
 {
-	ENTER_CRITICAL_SECTION;
+	CAN_ENTER_CRITICAL_SECTION;
 	buf->used --;
 	if (++buf->tail >= buf->size)
 		buf->tail = 0;
-	LEAVE_CRITICAL_SECTION;
+	CAN_LEAVE_CRITICAL_SECTION;
 }
 
 #endif
@@ -43,6 +43,8 @@ typedef struct {
 	uint8_t used;
 	uint8_t head;
 	uint8_t tail;
+	
+	bool shedding;		//!< only high priority messages are accepted
 } can_buffer_t;
 
 // -----------------------------------------------------------------------------
@@ -64,6 +66,43 @@ extern can_t *can_buffer_get_enqueue_ptr(can_buffer_t *buf);
  */
 extern void can_buffer_enqueue(can_buffer_t *buf);
 
+// -----------------------------------------------------------------------------
+/**
+ * Same as can_buffer_enqueue() but the new message is moved in front of
+ * all messages with a lower priority. Messages with the same identifier
+ * keep their order.
+ */
+extern void can_buffer_enqueue_sorted(can_buffer_t *buf);
+
+// -----------------------------------------------------------------------------
+/**
+ * Put a message back to the front of the buffer so that it will be the
+ * next one to be dequeued. With CAN_TX_PRIORITY_QUEUE the message is
+ * placed behind all messages with a higher priority instead.
+ *
+ * \return	false if the buffer is full
+ */
+extern bool can_buffer_requeue(can_buffer_t *buf, const can_t *msg);
+
+// -----------------------------------------------------------------------------
+/**
+ * Search the buffer for a message with the same identifier and overwrite
+ * its length and data with the content of \a msg. With CAN_TX_DEADLINE its
+ * deadline is removed.
+ *
+ * \return	false if no such message is waiting in the buffer
+ */
+extern bool can_buffer_replace(can_buffer_t *buf, const can_t *msg);
+
+// -----------------------------------------------------------------------------
+/**
+ * Check if a message may be added to the buffer. Above
+ * CAN_SHED_HIGH_WATERMARK only messages with a base identifier lower than
+ * CAN_SHED_PRIORITY_ID are accepted, until the buffer is drained to
+ * CAN_SHED_LOW_WATERMARK again.
+ */
+extern bool can_buffer_accept(can_buffer_t *buf, const can_t *msg);
+
 // -----------------------------------------------------------------------------
 extern can_t *can_buffer_get_dequeue_ptr(can_buffer_t *buf);
 
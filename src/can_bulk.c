@@ -0,0 +1,516 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_bulk.h"
+#include "can_private.h"
+
+#include <string.h>
+#include <util/crc16.h>
+
+// ----------------------------------------------------------------------------
+
+#define	BULK_START			0x01
+#define	BULK_CRC			0x02
+#define	BULK_ACK			0x10
+#define	BULK_ABORT			0x13
+
+#define	SLOT(block)			((block) % CAN_BULK_WINDOW_BLOCKS)
+
+// ----------------------------------------------------------------------------
+static bool _bulk_send_frame(uint16_t id, const uint8_t *data, uint8_t length)
+{
+	can_t msg;
+	
+	msg.id = id;
+	msg.flags.rtr = 0;
+	_can_classic_frame(&msg);
+	#if SUPPORT_EXTENDED_CANID
+	msg.flags.extended = 0;
+	#endif
+	msg.length = length;
+	memcpy(msg.data, data, length);
+	
+	return (can_send_message(&msg) != 0);
+}
+
+// ----------------------------------------------------------------------------
+static bool _bulk_is_message(uint16_t id, const can_t *msg)
+{
+	if (msg->id != id || msg->flags.rtr || msg->length == 0)
+		return false;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if (msg->flags.extended)
+		return false;
+	#endif
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// Number of frames of a block, only the last one may be shorter
+
+static uint8_t _bulk_frames(uint32_t size, uint16_t block)
+{
+	uint32_t offset = (uint32_t) block * CAN_BULK_BLOCK_SIZE;
+	
+	if (size - offset >= CAN_BULK_BLOCK_SIZE)
+		return CAN_BULK_BLOCK_FRAMES;
+	else
+		return (size - offset + 6) / 7;
+}
+
+// ----------------------------------------------------------------------------
+static uint8_t _bulk_block_size(uint32_t size, uint16_t block)
+{
+	uint32_t offset = (uint32_t) block * CAN_BULK_BLOCK_SIZE;
+	
+	if (size - offset >= CAN_BULK_BLOCK_SIZE)
+		return CAN_BULK_BLOCK_SIZE;
+	else
+		return size - offset;
+}
+
+// ----------------------------------------------------------------------------
+static uint32_t _bulk_mask(uint8_t frames)
+{
+	if (frames >= 32)
+		return 0xffffffffUL;
+	else
+		return (1UL << frames) - 1;
+}
+
+// ----------------------------------------------------------------------------
+// Sender
+// ----------------------------------------------------------------------------
+
+bool can_bulk_send(can_bulk_sender_t *sender, uint16_t tx_id, uint16_t rx_id,
+		uint32_t size, can_bulk_read_t read)
+{
+	if (size == 0 || size > CAN_BULK_MAX_SIZE)
+		return false;
+	
+	memset(sender, 0, sizeof(can_bulk_sender_t));
+	
+	sender->tx_id = tx_id;
+	sender->rx_id = rx_id;
+	sender->read = read;
+	sender->size = size;
+	sender->blocks = (size + CAN_BULK_BLOCK_SIZE - 1) / CAN_BULK_BLOCK_SIZE;
+	sender->crc = 0xffff;
+	sender->state = BULK_STARTING;
+	
+	// the start message is sent by can_bulk_sender_process()
+	sender->timer = 0;
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// Send one data frame, returns the CRC over the data if the frame was sent
+
+static bool _bulk_send_data(can_bulk_sender_t *sender, uint16_t block,
+		uint8_t frame, uint16_t *crc)
+{
+	uint8_t data[8];
+	uint16_t number = block * CAN_BULK_BLOCK_FRAMES + frame;
+	uint32_t offset = (uint32_t) number * 7;
+	uint8_t length = (sender->size - offset > 7) ? 7 : sender->size - offset;
+	
+	data[0] = number & 0xff;
+	sender->read(offset, data + 1, length);
+	memset(data + 1 + length, 0xff, 7 - length);
+	
+	if (!_bulk_send_frame(sender->tx_id, data, 8))
+		return false;
+	
+	if (crc != NULL) {
+		for (uint8_t i = 1; i <= length; i++)
+			*crc = _crc_ccitt_update(*crc, data[i]);
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+static bool _bulk_send_crc(can_bulk_sender_t *sender, uint16_t block)
+{
+	uint16_t crc = sender->crc_list[SLOT(block)];
+	uint8_t data[4] = { BULK_CRC, block & 0xff, crc & 0xff, crc >> 8 };
+	
+	if (!_bulk_send_frame(sender->tx_id, data, 4))
+		return false;
+	
+	sender->timer = CAN_BULK_TIMEOUT;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void can_bulk_sender_process(can_bulk_sender_t *sender)
+{
+	if (sender->state == BULK_STARTING)
+	{
+		if (sender->timer == 0)
+		{
+			uint8_t data[5] = { BULK_START,
+					sender->size & 0xff, (sender->size >> 8) & 0xff,
+					(sender->size >> 16) & 0xff, sender->size >> 24 };
+			
+			if (_bulk_send_frame(sender->tx_id, data, 5))
+				sender->timer = CAN_BULK_TIMEOUT;
+		}
+		return;
+	}
+	
+	while (sender->state == BULK_BUSY)
+	{
+		if (sender->resend)
+		{
+			// frames reported missing by the receiver
+			uint8_t frame = 0;
+			while (!(sender->resend & (1UL << frame)))
+				frame++;
+			
+			if (!_bulk_send_data(sender, sender->base, frame, NULL))
+				break;
+			
+			sender->resend &= ~(1UL << frame);
+		}
+		else if (sender->resend_crc)
+		{
+			// without outstanding blocks the CRC of the last acknowledged
+			// block is sent, the receiver only answers it with an
+			// acknowledge (e.g. to reopen a window of zero)
+			uint16_t block = sender->base;
+			if (block == sender->next)
+				block--;
+			
+			if (!_bulk_send_crc(sender, block))
+				break;
+			
+			sender->resend_crc = false;
+		}
+		else if (sender->crc_pending)
+		{
+			if (!_bulk_send_crc(sender, sender->next - 1))
+				break;
+			
+			sender->crc_pending = false;
+		}
+		else if (sender->next < sender->blocks &&
+				sender->next < sender->base + sender->window)
+		{
+			// new data
+			if (!_bulk_send_data(sender, sender->next, sender->frame, &sender->crc))
+				break;
+			
+			if (++sender->frame >= _bulk_frames(sender->size, sender->next))
+			{
+				sender->crc_list[SLOT(sender->next)] = sender->crc;
+				sender->crc = 0xffff;
+				sender->crc_pending = true;
+				sender->frame = 0;
+				sender->next++;
+			}
+		}
+		else {
+			// window is full
+			break;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+bool can_bulk_sender_handle_message(can_bulk_sender_t *sender, const can_t *msg)
+{
+	if (!_bulk_is_message(sender->rx_id, msg))
+		return false;
+	
+	const uint8_t *data = msg->data;
+	
+	if (data[0] == BULK_ABORT)
+	{
+		if (sender->state == BULK_STARTING || sender->state == BULK_BUSY)
+			sender->state = BULK_ABORTED;
+	}
+	else if (data[0] == BULK_ACK && msg->length >= 8)
+	{
+		if (sender->state != BULK_STARTING && sender->state != BULK_BUSY)
+			return true;
+		
+		uint16_t base = data[1] | ((uint16_t) data[2] << 8);
+		uint32_t missing;
+		memcpy(&missing, data + 4, 4);
+		
+		if (base < sender->base || base > sender->next)
+			return true;		// outdated or invalid
+		
+		if (base > sender->base) {
+			sender->base = base;
+			sender->resend = 0;
+			sender->resend_crc = false;
+		}
+		
+		sender->window = (data[3] > CAN_BULK_WINDOW_BLOCKS) ?
+				CAN_BULK_WINDOW_BLOCKS : data[3];
+		sender->state = BULK_BUSY;
+		sender->retries = 0;
+		sender->timer = CAN_BULK_TIMEOUT;
+		
+		if (base >= sender->blocks)
+		{
+			sender->state = BULK_DONE;
+		}
+		else if (missing != 0 && base < sender->next && sender->window != 0 &&
+				!(base == sender->next - 1 && sender->crc_pending))
+		{
+			// block was sent completely but frames got lost
+			// or the CRC didn't match. While the window is zero the
+			// receiver discards them anyway.
+			sender->resend = missing & _bulk_mask(_bulk_frames(sender->size, base));
+			sender->resend_crc = true;
+		}
+	}
+	
+	can_bulk_sender_process(sender);
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void can_bulk_sender_tick(can_bulk_sender_t *sender)
+{
+	if (sender->state != BULK_STARTING && sender->state != BULK_BUSY)
+		return;
+	
+	if (sender->timer == 0 || --sender->timer != 0)
+		return;
+	
+	if (++sender->retries > CAN_BULK_RETRIES) {
+		sender->state = BULK_TIMEOUT;
+		return;
+	}
+	
+	// ask the receiver for the state of the oldest block by sending
+	// its CRC again. The start message is repeated by the next call
+	// of can_bulk_sender_process() as the timer is zero now.
+	if (sender->state == BULK_BUSY)
+		sender->resend_crc = true;
+	
+	sender->timer = CAN_BULK_TIMEOUT;
+	if (sender->state == BULK_STARTING)
+		sender->timer = 0;
+}
+
+// ----------------------------------------------------------------------------
+// Receiver
+// ----------------------------------------------------------------------------
+
+void can_bulk_receive(can_bulk_receiver_t *receiver, uint16_t tx_id, uint16_t rx_id,
+		can_bulk_write_t write)
+{
+	memset(receiver, 0, sizeof(can_bulk_receiver_t));
+	
+	receiver->tx_id = tx_id;
+	receiver->rx_id = rx_id;
+	receiver->write = write;
+	receiver->window = CAN_BULK_WINDOW_BLOCKS;
+	receiver->state = BULK_IDLE;
+}
+
+// ----------------------------------------------------------------------------
+void can_bulk_set_window(can_bulk_receiver_t *receiver, uint8_t window)
+{
+	if (window > CAN_BULK_WINDOW_BLOCKS)
+		window = CAN_BULK_WINDOW_BLOCKS;
+	
+	receiver->window = window;
+	if (receiver->state == BULK_BUSY)
+		receiver->ack_pending = true;
+	
+	can_bulk_receiver_process(receiver);
+}
+
+// ----------------------------------------------------------------------------
+void can_bulk_receiver_process(can_bulk_receiver_t *receiver)
+{
+	if (!receiver->ack_pending)
+		return;
+	
+	if (receiver->state == BULK_ABORTED)
+	{
+		uint8_t data = BULK_ABORT;
+		
+		if (_bulk_send_frame(receiver->tx_id, &data, 1))
+			receiver->ack_pending = false;
+		return;
+	}
+	
+	uint8_t data[8];
+	uint32_t missing = 0;
+	uint16_t base = receiver->base;
+	
+	// the missing frames are only known after the CRC was received
+	if (base < receiver->blocks && (receiver->crc_valid & (1 << SLOT(base))))
+	{
+		missing = ~receiver->received[SLOT(base)] &
+				_bulk_mask(_bulk_frames(receiver->size, base));
+	}
+	
+	data[0] = BULK_ACK;
+	data[1] = base & 0xff;
+	data[2] = base >> 8;
+	data[3] = receiver->window;
+	memcpy(data + 4, &missing, 4);
+	
+	if (_bulk_send_frame(receiver->tx_id, data, 8))
+		receiver->ack_pending = false;
+}
+
+// ----------------------------------------------------------------------------
+// Write all complete blocks at the beginning of the window
+
+static void _bulk_write_blocks(can_bulk_receiver_t *receiver)
+{
+	while (receiver->base < receiver->blocks)
+	{
+		uint16_t base = receiver->base;
+		uint8_t slot = SLOT(base);
+		uint8_t frames = _bulk_frames(receiver->size, base);
+		
+		if (receiver->received[slot] != _bulk_mask(frames) ||
+				!(receiver->crc_valid & (1 << slot)))
+			break;
+		
+		uint8_t length = _bulk_block_size(receiver->size, base);
+		uint16_t crc = 0xffff;
+		for (uint8_t i = 0; i < length; i++)
+			crc = _crc_ccitt_update(crc, receiver->buffer[slot][i]);
+		
+		receiver->received[slot] = 0;
+		receiver->ack_pending = true;
+		
+		if (crc != receiver->crc_list[slot]) {
+			// request the whole block again (all frames are reported
+			// missing as the CRC stays valid)
+			break;
+		}
+		receiver->crc_valid &= ~(1 << slot);
+		
+		if (!receiver->write((uint32_t) base * CAN_BULK_BLOCK_SIZE,
+				receiver->buffer[slot], length))
+		{
+			receiver->state = BULK_ABORTED;
+			return;
+		}
+		
+		receiver->base++;
+	}
+	
+	if (receiver->base >= receiver->blocks)
+		receiver->state = BULK_DONE;
+}
+
+// ----------------------------------------------------------------------------
+bool can_bulk_receiver_handle_message(can_bulk_receiver_t *receiver, const can_t *msg)
+{
+	if (!_bulk_is_message(receiver->rx_id, msg))
+		return false;
+	
+	const uint8_t *data = msg->data;
+	
+	if (msg->length == 8)
+	{
+		// data frame
+		if (receiver->state != BULK_BUSY)
+			return true;
+		
+		// restore the full frame number from the 8 bit sequence
+		uint16_t first = receiver->base * CAN_BULK_BLOCK_FRAMES;
+		uint16_t number = first + (uint8_t) (data[0] - (first & 0xff));
+		
+		if (number - first >= CAN_BULK_BLOCK_FRAMES * CAN_BULK_WINDOW_BLOCKS)
+			return true;		// duplicate of an old frame
+		
+		uint16_t block = number / CAN_BULK_BLOCK_FRAMES;
+		uint8_t frame = number % CAN_BULK_BLOCK_FRAMES;
+		if (block >= receiver->blocks || block >= receiver->base + receiver->window)
+			return true;
+		
+		uint8_t slot = SLOT(block);
+		memcpy(&receiver->buffer[slot][frame * 7], data + 1, 7);
+		receiver->received[slot] |= (1UL << frame);
+	}
+	else if (data[0] == BULK_START && msg->length >= 5)
+	{
+		uint32_t size;
+		memcpy(&size, data + 1, 4);
+		
+		if (receiver->state == BULK_BUSY && size == receiver->size && receiver->base == 0)
+		{
+			// repeated start message, the acknowledge got lost
+		}
+		else if (receiver->state == BULK_BUSY || receiver->state == BULK_IDLE ||
+				receiver->state == BULK_DONE)
+		{
+			receiver->size = size;
+			receiver->blocks = (size + CAN_BULK_BLOCK_SIZE - 1) / CAN_BULK_BLOCK_SIZE;
+			receiver->base = 0;
+			receiver->crc_valid = 0;
+			memset(receiver->received, 0, sizeof(receiver->received));
+			
+			receiver->state = (size == 0 || size > CAN_BULK_MAX_SIZE) ?
+					BULK_ABORTED : BULK_BUSY;
+		}
+		receiver->ack_pending = true;
+	}
+	else if (data[0] == BULK_CRC && msg->length >= 4)
+	{
+		if (receiver->state != BULK_BUSY && receiver->state != BULK_DONE)
+			return true;
+		
+		uint16_t block = receiver->base + (uint8_t) (data[1] - (receiver->base & 0xff));
+		
+		// CRCs of blocks already written are only acknowledged again
+		if (block < receiver->base + CAN_BULK_WINDOW_BLOCKS && block < receiver->blocks)
+		{
+			uint8_t slot = SLOT(block);
+			receiver->crc_list[slot] = data[2] | ((uint16_t) data[3] << 8);
+			receiver->crc_valid |= (1 << slot);
+			
+			_bulk_write_blocks(receiver);
+		}
+		receiver->ack_pending = true;
+	}
+	
+	can_bulk_receiver_process(receiver);
+	
+	return true;
+}
@@ -0,0 +1,282 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+/**
+ * \file	can_bulk.h
+ * \brief	Windowed bulk transfer (e.g. firmware images)
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	CAN_BULK_H
+#define	CAN_BULK_H
+
+#if defined (__cplusplus)
+	extern "C" {
+#endif
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup		communication
+ * \defgroup	can_bulk Bulk transfer
+ * \brief		Transfer of large amounts of data with a sliding window
+ *
+ * The data is split into blocks of CAN_BULK_BLOCK_FRAMES frames with 7 bytes
+ * each. The sender transmits up to CAN_BULK_WINDOW_BLOCKS blocks without
+ * waiting, each followed by a frame with the CRC of the block. The receiver
+ * acknowledges the blocks cumulatively, announces how many blocks it can
+ * take (window) and lists the missing frames of the oldest block, so only
+ * these are sent again.
+ *
+ * Frames of the sender (standard ID \a tx_id of the sender):
+ * - data:  [sequence, 7 bytes], always 8 bytes
+ * - start: [0x01, size (32 bit)]
+ * - CRC:   [0x02, block, CRC-CCITT of the block (16 bit)]
+ *
+ * Frames of the receiver:
+ * - ack:   [0x10, next block (16 bit), window, missing frames (32 bit)]
+ * - abort: [0x13]
+ *
+ * All values are little endian. The sender keeps sending as long as
+ * can_send_message() accepts the frames, so all transmit buffers and MObs
+ * are kept busy.
+ */
+// ----------------------------------------------------------------------------
+
+#include "can.h"
+
+/**
+ * \ingroup	can_bulk
+ * \name	Settings
+ */
+//@{
+#ifndef	CAN_BULK_BLOCK_FRAMES
+	/// frames per block (1 .. 32)
+	#define	CAN_BULK_BLOCK_FRAMES	16
+#endif
+
+#ifndef	CAN_BULK_WINDOW_BLOCKS
+	/// blocks buffered by the receiver (1 .. 8)
+	#define	CAN_BULK_WINDOW_BLOCKS	2
+#endif
+
+#ifndef	CAN_BULK_TIMEOUT
+	/// time in milliseconds to wait for an acknowledge
+	#define	CAN_BULK_TIMEOUT		100
+#endif
+
+#ifndef	CAN_BULK_RETRIES
+	/// number of timeouts until the transfer is cancelled
+	#define	CAN_BULK_RETRIES		10
+#endif
+//@}
+
+#if CAN_BULK_BLOCK_FRAMES > 32 || CAN_BULK_WINDOW_BLOCKS > 8
+	#error	CAN_BULK_BLOCK_FRAMES has to be <= 32 and CAN_BULK_WINDOW_BLOCKS <= 8
+#endif
+
+// the sequence number has 8 bit, so the window must not exceed half of it
+#if CAN_BULK_BLOCK_FRAMES * CAN_BULK_WINDOW_BLOCKS > 128
+	#error	CAN_BULK_BLOCK_FRAMES * CAN_BULK_WINDOW_BLOCKS has to be <= 128
+#endif
+
+#define	CAN_BULK_BLOCK_SIZE		(CAN_BULK_BLOCK_FRAMES * 7)
+
+/// largest possible transfer (65535 frames)
+#define	CAN_BULK_MAX_SIZE		(65535UL * 7)
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	State of a transfer
+ */
+typedef enum {
+	BULK_IDLE,
+	BULK_STARTING,		//!< waiting for the receiver
+	BULK_BUSY,			//!< transfer in progress
+	BULK_DONE,			//!< all data transferred
+	BULK_TIMEOUT,		//!< the other side didn't answer
+	BULK_ABORTED		//!< cancelled by the receiver
+} can_bulk_state_t;
+
+/**
+ * \ingroup	can_bulk
+ * \brief	Read \a length bytes at \a offset of the data to be sent
+ */
+typedef void (*can_bulk_read_t)(uint32_t offset, uint8_t *data, uint8_t length);
+
+/**
+ * \ingroup	can_bulk
+ * \brief	Write a received and checked block
+ *
+ * \return	false to cancel the transfer
+ */
+typedef bool (*can_bulk_write_t)(uint32_t offset, const uint8_t *data, uint8_t length);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Sending side of a transfer
+ */
+typedef struct {
+	uint16_t tx_id;
+	uint16_t rx_id;
+	can_bulk_read_t read;
+	can_bulk_state_t state;		//!< state of the transfer
+	
+	uint32_t size;
+	uint16_t blocks;
+	uint16_t base;				// oldest block not acknowledged
+	uint16_t next;				// next block to be sent the first time
+	uint8_t frame;				// next frame of this block
+	uint8_t window;				// blocks the receiver accepts after base
+	bool crc_pending;			// CRC of the block before 'next' not sent
+	bool resend_crc;			// CRC of 'base' (or 'base - 1') has to be sent again
+	uint32_t resend;			// frames of 'base' to be sent again
+	uint16_t crc;				// CRC of the block being sent
+	uint16_t crc_list[CAN_BULK_WINDOW_BLOCKS];
+	uint16_t timer;
+	uint8_t retries;
+} can_bulk_sender_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Receiving side of a transfer
+ */
+typedef struct {
+	uint16_t tx_id;
+	uint16_t rx_id;
+	can_bulk_write_t write;
+	can_bulk_state_t state;		//!< state of the transfer
+	uint8_t window;				// blocks announced to the sender
+	
+	uint32_t size;
+	uint16_t blocks;
+	uint16_t base;				// next block to be written
+	bool ack_pending;
+	uint8_t crc_valid;			// bit n => CRC of slot n received
+	uint16_t crc_list[CAN_BULK_WINDOW_BLOCKS];
+	uint32_t received[CAN_BULK_WINDOW_BLOCKS];
+	uint8_t buffer[CAN_BULK_WINDOW_BLOCKS][CAN_BULK_BLOCK_SIZE];
+} can_bulk_receiver_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Start sending \a size bytes
+ *
+ * \param	sender	Transfer
+ * \param	tx_id	ID of the frames of the sender
+ * \param	rx_id	ID of the frames of the receiver
+ * \param	size	Number of bytes (up to CAN_BULK_MAX_SIZE)
+ * \param	read	Function which provides the data
+ * \return	false if \a size is too big
+ */
+extern bool
+can_bulk_send(can_bulk_sender_t *sender, uint16_t tx_id, uint16_t rx_id,
+		uint32_t size, can_bulk_read_t read);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Prepare the reception of a transfer
+ *
+ * The transfer starts when the sender calls can_bulk_send().
+ */
+extern void
+can_bulk_receive(can_bulk_receiver_t *receiver, uint16_t tx_id, uint16_t rx_id,
+		can_bulk_write_t write);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Pass a received message to the sender
+ *
+ * \return	true if the message belongs to the transfer
+ */
+extern bool
+can_bulk_sender_handle_message(can_bulk_sender_t *sender, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Pass a received message to the receiver
+ *
+ * \return	true if the message belongs to the transfer
+ */
+extern bool
+can_bulk_receiver_handle_message(can_bulk_receiver_t *receiver, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Send as many frames as possible
+ *
+ * Should be called as often as possible.
+ */
+extern void
+can_bulk_sender_process(can_bulk_sender_t *sender);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Send a pending acknowledge
+ *
+ * Only needed if the transmit buffers were full while the answer should
+ * be sent, e.g. call it together with can_get_message().
+ */
+extern void
+can_bulk_receiver_process(can_bulk_receiver_t *receiver);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Change the number of blocks the sender may send in advance
+ *
+ * 0 stops the sender (e.g. while a flash page is erased), the maximum is
+ * CAN_BULK_WINDOW_BLOCKS.
+ */
+extern void
+can_bulk_set_window(can_bulk_receiver_t *receiver, uint8_t window);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_bulk
+ * \brief	Time base of the sender
+ *
+ * Has to be called every millisecond, but not from an interrupt.
+ */
+extern void
+can_bulk_sender_tick(can_bulk_sender_t *sender);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif	// CAN_BULK_H
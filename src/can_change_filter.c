@@ -0,0 +1,137 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "can_private.h"
+#include "utils.h"
+
+#if CAN_CHANGE_FILTER_SLOTS > 0
+
+typedef struct {
+	can_filter_t filter;
+	can_t last;				//!< last delivered message
+	uint8_t refresh;
+	uint8_t timeout;		//!< ticks until a repetition is delivered again
+	bool expired;
+	bool valid;
+} can_change_filter_t;
+
+static can_change_filter_t _can_change_filter_list[CAN_CHANGE_FILTER_SLOTS];
+
+// ----------------------------------------------------------------------------
+bool can_set_change_filter(uint8_t number, const can_filter_t *filter, uint8_t refresh)
+{
+	if (number >= CAN_CHANGE_FILTER_SLOTS)
+		return false;
+	
+	can_change_filter_t *slot = &_can_change_filter_list[number];
+	
+	// disable the slot while it is changed
+	ENTER_CRITICAL_SECTION;
+	slot->valid = false;
+	LEAVE_CRITICAL_SECTION;
+	
+	if (filter != NULL)
+	{
+		slot->filter = *filter;
+		slot->refresh = refresh;
+		
+		// the first message is always delivered
+		slot->expired = true;
+		
+		ENTER_CRITICAL_SECTION;
+		slot->valid = true;
+		LEAVE_CRITICAL_SECTION;
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void can_change_filter_tick(void)
+{
+	can_change_filter_t *slot = _can_change_filter_list;
+	
+	for (uint8_t i = 0; i < CAN_CHANGE_FILTER_SLOTS; i++, slot++)
+	{
+		ENTER_CRITICAL_SECTION;
+		if (!slot->expired && slot->refresh != 0 && --slot->timeout == 0)
+			slot->expired = true;
+		LEAVE_CRITICAL_SECTION;
+	}
+}
+
+// ----------------------------------------------------------------------------
+bool _can_suppress_unchanged(const can_t *msg)
+{
+	can_change_filter_t *slot = _can_change_filter_list;
+	
+	for (uint8_t i = 0; i < CAN_CHANGE_FILTER_SLOTS; i++, slot++)
+	{
+		if (!slot->valid || !_can_filter_match(&slot->filter, msg))
+			continue;
+		
+		bool unchanged = false;
+		
+		ENTER_CRITICAL_SECTION;
+		const can_t *last = &slot->last;
+		
+		if (!slot->expired &&
+				last->id == msg->id &&
+				#if SUPPORT_EXTENDED_CANID
+				last->flags.extended == msg->flags.extended &&
+				#endif
+				last->flags.rtr == msg->flags.rtr &&
+				#if SUPPORT_CAN_FD
+				last->flags.fd == msg->flags.fd &&
+				#endif
+				last->length == msg->length &&
+				memcmp(last->data, msg->data, (msg->length > sizeof(msg->data)) ?
+						sizeof(msg->data) : msg->length) == 0)
+		{
+			_can_statistics.rx_unchanged++;
+			unchanged = true;
+		}
+		else {
+			// deliver the message and restart the refresh timeout
+			slot->last = *msg;
+			slot->timeout = slot->refresh;
+			slot->expired = false;
+		}
+		LEAVE_CRITICAL_SECTION;
+		
+		return unchanged;
+	}
+	
+	return false;
+}
+
+#endif
@@ -0,0 +1,456 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_private.h"
+#include "utils.h"
+
+#if CAN_FREERTOS
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+// ----------------------------------------------------------------------------
+// FreeRTOS port
+// 
+// The receive interrupt gives _can_rx_event after every message stored in
+// the receive buffer, tasks waiting for a message block on it. Messages
+// accepted by a subscription are put into its queue instead. Both only
+// note if a task was woken, the yield follows at the end of the interrupt
+// (_can_freertos_isr_exit()).
+// 
+// All functions which access the controller or the receive buffer are
+// serialized by a recursive mutex, which is also available to the
+// application through can_lock()/can_unlock(). The drivers provide them
+// as _can_xxx(), see _CAN_LOCKED() in can_private.h.
+
+#ifndef	pdMS_TO_TICKS
+	#define	pdMS_TO_TICKS(ms)		((TickType_t) (ms) / portTICK_PERIOD_MS)
+#endif
+
+static SemaphoreHandle_t _can_mutex;
+static SemaphoreHandle_t _can_rx_event;
+
+static BaseType_t _can_task_woken;
+
+#if CAN_SUBSCRIPTION_SLOTS > 0
+typedef struct {
+	can_filter_t filter;
+	QueueHandle_t queue;
+	bool valid;
+} can_subscription_t;
+
+static can_subscription_t _can_subscription_list[CAN_SUBSCRIPTION_SLOTS];
+#endif
+
+// ----------------------------------------------------------------------------
+bool can_freertos_init(void)
+{
+	_can_mutex = xSemaphoreCreateRecursiveMutex();
+	_can_rx_event = xSemaphoreCreateBinary();
+	
+	if (_can_mutex == NULL || _can_rx_event == NULL)
+		return false;
+	
+	#if CAN_SUBSCRIPTION_SLOTS > 0
+	for (uint8_t i = 0; i < CAN_SUBSCRIPTION_SLOTS; i++)
+	{
+		_can_subscription_list[i].queue = xQueueCreate(CAN_SUBSCRIPTION_QUEUE_SIZE, sizeof(can_t));
+		if (_can_subscription_list[i].queue == NULL)
+			return false;
+	}
+	#endif
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void can_lock(void)
+{
+	xSemaphoreTakeRecursive(_can_mutex, portMAX_DELAY);
+}
+
+// ----------------------------------------------------------------------------
+void can_unlock(void)
+{
+	xSemaphoreGiveRecursive(_can_mutex);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_send_message(const can_t *msg)
+{
+	can_lock();
+	uint8_t result = _can_send_message(msg);
+	can_unlock();
+	
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_get_message(can_t *msg)
+{
+	can_lock();
+	uint8_t result = _can_get_message(msg);
+	can_unlock();
+	
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+bool can_check_free_buffer(void)
+{
+	can_lock();
+	bool result = _can_check_free_buffer();
+	can_unlock();
+	
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_send_message_preemptive(const can_t *msg, can_t *aborted)
+{
+	can_lock();
+	uint8_t result = _can_send_message_preemptive(msg, aborted);
+	can_unlock();
+	
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_send_template(const can_template_t *tpl, const uint8_t *data)
+{
+	can_lock();
+	uint8_t result = _can_send_template(tpl, data);
+	can_unlock();
+	
+	return result;
+}
+
+#if SUPPORT_TIMESTAMPS
+// ----------------------------------------------------------------------------
+uint8_t can_send_timestamped_message(const can_t *msg)
+{
+	can_lock();
+	uint8_t result = _can_send_timestamped_message(msg);
+	can_unlock();
+	
+	return result;
+}
+#endif
+
+// ----------------------------------------------------------------------------
+can_error_register_t can_read_error_register(void)
+{
+	can_lock();
+	can_error_register_t result = _can_read_error_register();
+	can_unlock();
+	
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+void can_set_mode(can_mode_t mode)
+{
+	can_lock();
+	_can_set_mode(mode);
+	can_unlock();
+}
+
+// ----------------------------------------------------------------------------
+void can_set_one_shot(bool enable)
+{
+	can_lock();
+	_can_set_one_shot(enable);
+	can_unlock();
+}
+
+// ----------------------------------------------------------------------------
+bool can_set_filter(uint8_t number, const can_filter_t *filter)
+{
+	can_lock();
+	bool result = _can_set_filter(number, filter);
+	can_unlock();
+	
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_get_filter(uint8_t number, can_filter_t *filter)
+{
+	can_lock();
+	uint8_t result = _can_get_filter(number, filter);
+	can_unlock();
+	
+	return result;
+}
+
+#if BUILD_FOR_MCP2515
+// ----------------------------------------------------------------------------
+void can_static_filter(const uint8_t *filter_array)
+{
+	can_lock();
+	_can_static_filter(filter_array);
+	can_unlock();
+}
+
+// ----------------------------------------------------------------------------
+void can_static_filter2(uint8_t *filter_array)
+{
+	can_lock();
+	_can_static_filter2(filter_array);
+	can_unlock();
+}
+
+// ----------------------------------------------------------------------------
+void can_sleep(void)
+{
+	can_lock();
+	_can_sleep();
+	can_unlock();
+}
+
+// ----------------------------------------------------------------------------
+void can_wakeup(void)
+{
+	can_lock();
+	_can_wakeup();
+	can_unlock();
+}
+#endif	// BUILD_FOR_MCP2515
+
+#if BUILD_FOR_AT90CAN
+// ----------------------------------------------------------------------------
+bool can_disable_filter(uint8_t number)
+{
+	can_lock();
+	bool result = _can_disable_filter(number);
+	can_unlock();
+	
+	return result;
+}
+
+#if CAN_TX_BUFFER_SIZE > 0 && CAN_TX_DEADLINE
+// ----------------------------------------------------------------------------
+uint8_t can_send_message_deadline(const can_t *msg, uint16_t max_age)
+{
+	can_lock();
+	uint8_t result = _can_send_message_deadline(msg, max_age);
+	can_unlock();
+	
+	return result;
+}
+#endif
+
+// ----------------------------------------------------------------------------
+uint8_t can_send_latest_message(const can_t *msg)
+{
+	can_lock();
+	uint8_t result = _can_send_latest_message(msg);
+	can_unlock();
+	
+	return result;
+}
+
+#if CAN_PERIODIC_MOBS > 0
+// ----------------------------------------------------------------------------
+bool can_set_periodic_message(uint8_t number, const can_t *msg)
+{
+	can_lock();
+	bool result = _can_set_periodic_message(number, msg);
+	can_unlock();
+	
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+bool can_send_periodic_message(uint8_t number, const uint8_t *data, uint8_t changed)
+{
+	can_lock();
+	bool result = _can_send_periodic_message(number, data, changed);
+	can_unlock();
+	
+	return result;
+}
+#endif
+
+#if CAN_AUTO_REPLY_SLOTS > 0
+// ----------------------------------------------------------------------------
+bool can_set_auto_reply(uint8_t number, const can_t *msg)
+{
+	can_lock();
+	bool result = _can_set_auto_reply(number, msg);
+	can_unlock();
+	
+	return result;
+}
+#endif
+#endif	// BUILD_FOR_AT90CAN
+
+// ----------------------------------------------------------------------------
+static TickType_t _can_ticks(int16_t timeout)
+{
+	if (timeout < 0)
+		return portMAX_DELAY;
+	
+	return pdMS_TO_TICKS(timeout);
+}
+
+// ----------------------------------------------------------------------------
+// The semaphore may be left over from a message which was already taken
+// by another task, so the buffer is checked again after every wakeup.
+
+static bool _can_wait(TimeOut_t *start, TickType_t *ticks)
+{
+	while (!can_check_message())
+	{
+		if (xSemaphoreTake(_can_rx_event, *ticks) != pdTRUE)
+			return false;
+		
+		if (xTaskCheckForTimeOut(start, ticks) != pdFALSE)
+			return can_check_message();
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+bool can_wait_message(int16_t timeout)
+{
+	TimeOut_t start;
+	TickType_t ticks = _can_ticks(timeout);
+	
+	vTaskSetTimeOutState(&start);
+	
+	return _can_wait(&start, &ticks);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_get_message_timeout(can_t *msg, int16_t timeout)
+{
+	TimeOut_t start;
+	TickType_t ticks = _can_ticks(timeout);
+	
+	vTaskSetTimeOutState(&start);
+	
+	while (_can_wait(&start, &ticks))
+	{
+		// another task might have been faster, can_get_message() takes
+		// the mutex so that every message is only returned once
+		uint8_t result = can_get_message(msg);
+		if (result != 0)
+			return result;
+	}
+	
+	return 0;
+}
+
+#if CAN_SUBSCRIPTION_SLOTS > 0
+// ----------------------------------------------------------------------------
+bool can_set_subscription(uint8_t number, const can_filter_t *filter)
+{
+	if (number >= CAN_SUBSCRIPTION_SLOTS)
+		return false;
+	
+	can_subscription_t *subscription = &_can_subscription_list[number];
+	
+	// disable the subscription while it is changed
+	CAN_ENTER_CRITICAL_SECTION;
+	subscription->valid = false;
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	// drop the messages of the old filter
+	xQueueReset(subscription->queue);
+	
+	if (filter != NULL)
+	{
+		subscription->filter = *filter;
+		
+		CAN_ENTER_CRITICAL_SECTION;
+		subscription->valid = true;
+		CAN_LEAVE_CRITICAL_SECTION;
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+bool can_get_subscribed_message(uint8_t number, can_t *msg, int16_t timeout)
+{
+	if (number >= CAN_SUBSCRIPTION_SLOTS)
+		return false;
+	
+	return (xQueueReceive(_can_subscription_list[number].queue, msg, _can_ticks(timeout)) == pdTRUE);
+}
+
+// ----------------------------------------------------------------------------
+bool _can_subscription_dispatch(const can_t *msg)
+{
+	can_subscription_t *subscription = _can_subscription_list;
+	
+	for (uint8_t i = 0; i < CAN_SUBSCRIPTION_SLOTS; i++, subscription++)
+	{
+		if (!subscription->valid || !_can_filter_match(&subscription->filter, msg))
+			continue;
+		
+		if (xQueueSendFromISR(subscription->queue, msg, &_can_task_woken) != pdTRUE) {
+			// the task doesn't keep up => reject message
+			_can_statistics.rx_overflow++;
+		}
+		
+		return true;
+	}
+	
+	return false;
+}
+#endif
+
+// ----------------------------------------------------------------------------
+void _can_freertos_rx_notify(void)
+{
+	xSemaphoreGiveFromISR(_can_rx_event, &_can_task_woken);
+}
+
+// ----------------------------------------------------------------------------
+void _can_freertos_isr_exit(void)
+{
+	if (_can_task_woken != pdFALSE)
+	{
+		_can_task_woken = pdFALSE;
+		
+		#ifdef	portYIELD_FROM_ISR
+			portYIELD_FROM_ISR(pdTRUE);
+		#else
+			taskYIELD();
+		#endif
+	}
+}
+
+#endif	// CAN_FREERTOS
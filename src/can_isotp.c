@@ -0,0 +1,353 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_isotp.h"
+#include "can_private.h"
+
+#include <string.h>
+
+// ----------------------------------------------------------------------------
+// protocol control information (upper nibble of the first byte)
+
+#define	PCI_SINGLE_FRAME		0x00
+#define	PCI_FIRST_FRAME			0x10
+#define	PCI_CONSECUTIVE_FRAME	0x20
+#define	PCI_FLOW_CONTROL		0x30
+
+#define	FC_CONTINUE				0
+#define	FC_WAIT					1
+#define	FC_OVERFLOW				2
+
+#define	FC_NONE					0xff
+
+// ----------------------------------------------------------------------------
+static bool _isotp_send_frame(can_isotp_t *link, const uint8_t *pci,
+		uint8_t pci_length, const uint8_t *data, uint8_t length)
+{
+	can_t msg;
+	
+	msg.id = link->tx_id;
+	msg.flags.rtr = 0;
+	_can_classic_frame(&msg);
+	#if SUPPORT_EXTENDED_CANID
+	msg.flags.extended = link->extended;
+	#endif
+	
+	memcpy(msg.data, pci, pci_length);
+	if (length != 0)
+		memcpy(msg.data + pci_length, data, length);
+	msg.length = pci_length + length;
+	
+	#ifdef	CAN_ISOTP_PADDING
+	// fill the unused bytes, some ECUs only accept frames with 8 bytes
+	while (msg.length < 8)
+		msg.data[msg.length++] = CAN_ISOTP_PADDING;
+	#endif
+	
+	return (can_send_message(&msg) != 0);
+}
+
+// ----------------------------------------------------------------------------
+// Convert STmin to milliseconds. Values below 1 ms are rounded up,
+// reserved values are treated as the maximum (127 ms).
+
+static uint8_t _isotp_st_min(uint8_t st_min)
+{
+	if (st_min <= 0x7f)
+		return st_min;
+	else if (st_min >= 0xf1 && st_min <= 0xf9)
+		return 1;
+	else
+		return 0x7f;
+}
+
+// ----------------------------------------------------------------------------
+void can_isotp_init(can_isotp_t *link, uint32_t tx_id, uint32_t rx_id)
+{
+	memset(link, 0, sizeof(can_isotp_t));
+	
+	link->tx_id = tx_id;
+	link->rx_id = rx_id;
+	#if SUPPORT_EXTENDED_CANID
+	link->extended = (tx_id > 0x7ff || rx_id > 0x7ff);
+	#endif
+	
+	link->tx_state = ISOTP_IDLE;
+	link->rx_state = ISOTP_DONE;		// no buffer yet
+	link->rx_flow_control = FC_NONE;
+}
+
+// ----------------------------------------------------------------------------
+bool can_isotp_send(can_isotp_t *link, const uint8_t *data, uint16_t length)
+{
+	uint8_t pci[2];
+	
+	if (link->tx_state == ISOTP_WAIT_FC || link->tx_state == ISOTP_BUSY)
+		return false;
+	
+	if (length == 0 || length > 4095)
+		return false;
+	
+	if (length <= 7)
+	{
+		pci[0] = PCI_SINGLE_FRAME | length;
+		if (!_isotp_send_frame(link, pci, 1, data, length))
+			return false;
+		
+		link->tx_state = ISOTP_DONE;
+		return true;
+	}
+	
+	pci[0] = PCI_FIRST_FRAME | (length >> 8);
+	pci[1] = length & 0xff;
+	if (!_isotp_send_frame(link, pci, 2, data, 6))
+		return false;
+	
+	link->tx_data = data;
+	link->tx_length = length;
+	link->tx_offset = 6;
+	link->tx_sequence = 1;
+	link->tx_timer = CAN_ISOTP_TIMEOUT;
+	link->tx_state = ISOTP_WAIT_FC;
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void can_isotp_set_buffer(can_isotp_t *link, uint8_t *buffer, uint16_t size)
+{
+	link->rx_buffer = buffer;
+	link->rx_size = size;
+	link->rx_length = 0;
+	link->rx_state = ISOTP_IDLE;
+}
+
+// ----------------------------------------------------------------------------
+// A new message may only be received if a buffer is set. A new single or
+// first frame aborts the current reception.
+
+static bool _isotp_ready(const can_isotp_t *link)
+{
+	return (link->rx_state == ISOTP_IDLE || link->rx_state == ISOTP_BUSY);
+}
+
+// ----------------------------------------------------------------------------
+static void _isotp_flow_control(can_isotp_t *link, const can_t *msg)
+{
+	if (link->tx_state != ISOTP_WAIT_FC || msg->length < 3)
+		return;
+	
+	switch (msg->data[0] & 0x0f)
+	{
+		case FC_CONTINUE:
+			link->tx_block_size = msg->data[1];
+			link->tx_block = msg->data[1];
+			link->tx_st_min = _isotp_st_min(msg->data[2]);
+			link->tx_timer = 0;
+			link->tx_state = ISOTP_BUSY;
+			break;
+		
+		case FC_WAIT:
+			link->tx_timer = CAN_ISOTP_TIMEOUT;
+			break;
+		
+		case FC_OVERFLOW:
+			link->tx_state = ISOTP_OVERFLOW;
+			break;
+		
+		default:
+			link->tx_state = ISOTP_ERROR;
+			break;
+	}
+}
+
+// ----------------------------------------------------------------------------
+bool can_isotp_handle_message(can_isotp_t *link, const can_t *msg)
+{
+	if (msg->id != link->rx_id || msg->flags.rtr || msg->length == 0)
+		return false;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if (msg->flags.extended != link->extended)
+		return false;
+	#endif
+	
+	const uint8_t *data = msg->data;
+	uint8_t length;
+	
+	switch (data[0] & 0xf0)
+	{
+		case PCI_SINGLE_FRAME:
+			length = data[0] & 0x0f;
+			if (!_isotp_ready(link) || length == 0 ||
+					length > msg->length - 1)
+				break;
+			
+			if (length > link->rx_size) {
+				link->rx_state = ISOTP_OVERFLOW;
+				break;
+			}
+			
+			memcpy(link->rx_buffer, data + 1, length);
+			link->rx_length = length;
+			link->rx_state = ISOTP_DONE;
+			break;
+		
+		case PCI_FIRST_FRAME:
+			if (!_isotp_ready(link) || msg->length < 8)
+				break;
+			
+			// messages up to 7 bytes have to be sent as single frame,
+			// such a first frame is ignored (ISO 15765-2)
+			if ((data[0] & 0x0f) == 0 && data[1] < 8)
+				break;
+			
+			link->rx_length = ((uint16_t) (data[0] & 0x0f) << 8) | data[1];
+			if (link->rx_length > link->rx_size)
+			{
+				// tell the sender that we can't receive this message
+				link->rx_flow_control = FC_OVERFLOW;
+				link->rx_state = ISOTP_OVERFLOW;
+				break;
+			}
+			
+			memcpy(link->rx_buffer, data + 2, 6);
+			link->rx_offset = 6;
+			link->rx_sequence = 1;
+			link->rx_block = link->block_size;
+			link->rx_timer = CAN_ISOTP_TIMEOUT;
+			link->rx_flow_control = FC_CONTINUE;
+			link->rx_state = ISOTP_BUSY;
+			break;
+		
+		case PCI_CONSECUTIVE_FRAME:
+			if (link->rx_state != ISOTP_BUSY)
+				break;
+			
+			if ((data[0] & 0x0f) != link->rx_sequence) {
+				link->rx_state = ISOTP_ERROR;
+				break;
+			}
+			link->rx_sequence = (link->rx_sequence + 1) & 0x0f;
+			
+			length = link->rx_length - link->rx_offset;
+			if (length > 7)
+				length = 7;
+			if (length > msg->length - 1) {
+				link->rx_state = ISOTP_ERROR;
+				break;
+			}
+			
+			memcpy(link->rx_buffer + link->rx_offset, data + 1, length);
+			link->rx_offset += length;
+			link->rx_timer = CAN_ISOTP_TIMEOUT;
+			
+			if (link->rx_offset >= link->rx_length) {
+				link->rx_state = ISOTP_DONE;
+			}
+			else if (link->block_size != 0 && --link->rx_block == 0) {
+				// block complete => allow the next one
+				link->rx_block = link->block_size;
+				link->rx_flow_control = FC_CONTINUE;
+			}
+			break;
+		
+		case PCI_FLOW_CONTROL:
+			_isotp_flow_control(link, msg);
+			break;
+		
+		default:
+			break;
+	}
+	
+	// send the flow control frame immediately if possible
+	can_isotp_process(link);
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void can_isotp_process(can_isotp_t *link)
+{
+	if (link->rx_flow_control != FC_NONE)
+	{
+		uint8_t pci[3];
+		
+		pci[0] = PCI_FLOW_CONTROL | link->rx_flow_control;
+		pci[1] = link->block_size;
+		pci[2] = link->st_min;
+		
+		if (_isotp_send_frame(link, pci, 3, NULL, 0))
+			link->rx_flow_control = FC_NONE;
+	}
+	
+	// send consecutive frames as long as the peer and the transmit
+	// buffers allow it
+	while (link->tx_state == ISOTP_BUSY && link->tx_timer == 0)
+	{
+		uint8_t pci = PCI_CONSECUTIVE_FRAME | link->tx_sequence;
+		uint16_t length = link->tx_length - link->tx_offset;
+		if (length > 7)
+			length = 7;
+		
+		if (!_isotp_send_frame(link, &pci, 1,
+				link->tx_data + link->tx_offset, length))
+			break;
+		
+		link->tx_offset += length;
+		link->tx_sequence = (link->tx_sequence + 1) & 0x0f;
+		
+		if (link->tx_offset >= link->tx_length) {
+			link->tx_state = ISOTP_DONE;
+		}
+		else if (link->tx_block_size != 0 && --link->tx_block == 0) {
+			// wait for the next flow control frame
+			link->tx_timer = CAN_ISOTP_TIMEOUT;
+			link->tx_state = ISOTP_WAIT_FC;
+		}
+		else if (link->tx_st_min != 0) {
+			// +1 because the next tick may follow immediately
+			link->tx_timer = link->tx_st_min + 1;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+void can_isotp_tick(can_isotp_t *link)
+{
+	if (link->tx_timer != 0 && --link->tx_timer == 0)
+	{
+		if (link->tx_state == ISOTP_WAIT_FC)
+			link->tx_state = ISOTP_TIMEOUT;
+	}
+	
+	if (link->rx_state == ISOTP_BUSY && --link->rx_timer == 0)
+		link->rx_state = ISOTP_TIMEOUT;
+}
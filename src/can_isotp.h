@@ -0,0 +1,234 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+/**
+ * \file	can_isotp.h
+ * \brief	ISO-TP (ISO 15765-2) transport layer
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	CAN_ISOTP_H
+#define	CAN_ISOTP_H
+
+#if defined (__cplusplus)
+	extern "C" {
+#endif
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup		communication
+ * \defgroup	can_isotp ISO-TP
+ * \brief		Transfer of up to 4095 bytes with single, first, consecutive
+ *				and flow control frames
+ *
+ * The data is segmented directly from the buffer of the caller and
+ * reassembled directly into the buffer given to can_isotp_set_buffer(),
+ * there is no intermediate copy. The frames are sent with
+ * can_send_message(), so the transmit buffer of the library is used.
+ *
+ * \code
+ * can_isotp_t link;
+ * uint8_t buffer[256];
+ *
+ * can_isotp_init(&link, 0x7e8, 0x7e0);
+ * can_isotp_set_buffer(&link, buffer, sizeof(buffer));
+ *
+ * while (1)
+ * {
+ *     can_t msg;
+ *     if (can_get_message(&msg))
+ *         can_isotp_handle_message(&link, &msg);
+ *
+ *     if (millisecond_elapsed)
+ *         can_isotp_tick(&link);
+ *
+ *     can_isotp_process(&link);
+ *
+ *     if (link.rx_state == ISOTP_DONE) {
+ *         // link.rx_length bytes received in buffer
+ *         ...
+ *         can_isotp_set_buffer(&link, buffer, sizeof(buffer));
+ *     }
+ * }
+ * \endcode
+ */
+// ----------------------------------------------------------------------------
+
+#include "can.h"
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	Time in milliseconds to wait for a flow control or
+ *			consecutive frame (N_Bs, N_Cr)
+ */
+#ifndef	CAN_ISOTP_TIMEOUT
+	#define	CAN_ISOTP_TIMEOUT		1000
+#endif
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	State of a transfer
+ */
+typedef enum {
+	ISOTP_IDLE,			//!< nothing to do, ready for a new transfer
+	ISOTP_WAIT_FC,		//!< waiting for a flow control frame of the receiver
+	ISOTP_BUSY,			//!< transfer in progress
+	ISOTP_DONE,			//!< transfer complete
+	ISOTP_TIMEOUT,		//!< the other side didn't answer in time
+	ISOTP_OVERFLOW,		//!< message too long for the buffer of the receiver
+	ISOTP_ERROR			//!< wrong sequence number or unexpected frame
+} can_isotp_state_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	Connection to one peer
+ *
+ * Only the fields documented here are meant to be used by the application.
+ */
+typedef struct {
+	uint32_t tx_id;				//!< ID of the sent frames
+	uint32_t rx_id;				//!< ID of the received frames
+	#if SUPPORT_EXTENDED_CANID
+	bool extended;				//!< use extended IDs
+	#endif
+	
+	uint8_t block_size;			//!< BS sent to the peer, 0 => no limit
+	uint8_t st_min;				//!< STmin sent to the peer
+	
+	can_isotp_state_t tx_state;	//!< state of the transmission
+	can_isotp_state_t rx_state;	//!< state of the reception
+	uint16_t rx_length;			//!< length of the received message
+	
+	// transmission
+	const uint8_t *tx_data;
+	uint16_t tx_length;
+	uint16_t tx_offset;
+	uint16_t tx_timer;
+	uint8_t tx_sequence;
+	uint8_t tx_block_size;		// BS and STmin of the peer
+	uint8_t tx_block;
+	uint8_t tx_st_min;
+	
+	// reception
+	uint8_t *rx_buffer;
+	uint16_t rx_size;
+	uint16_t rx_offset;
+	uint16_t rx_timer;
+	uint8_t rx_sequence;
+	uint8_t rx_block;
+	uint8_t rx_flow_control;	// flow status to send, 0xff => nothing
+} can_isotp_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	Initialize a connection
+ *
+ * BS and STmin requested from the peer are set to 0, so the peer may send
+ * as fast as possible. Reduce them if the receive buffer of the CAN
+ * controller overflows.
+ *
+ * \param	link	Connection
+ * \param	tx_id	ID used for sending
+ * \param	rx_id	ID of the messages from the peer
+ *
+ * \note	Extended IDs are used if one of the IDs is above 0x7ff, this
+ *			can be changed afterwards with the field \a extended.
+ */
+extern void
+can_isotp_init(can_isotp_t *link, uint32_t tx_id, uint32_t rx_id);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	Start sending a message
+ *
+ * The data is not copied, the buffer has to stay unchanged until
+ * \a tx_state is not ISOTP_WAIT_FC or ISOTP_BUSY anymore.
+ *
+ * \param	link	Connection
+ * \param	data	Message
+ * \param	length	Length of the message (1 .. 4095)
+ * \return	false if a transmission is already in progress or the first
+ *			frame could not be sent
+ */
+extern bool
+can_isotp_send(can_isotp_t *link, const uint8_t *data, uint16_t length);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	Set the buffer for the next received message
+ *
+ * Has to be called again after a message was received (\a rx_state is
+ * ISOTP_DONE) or the reception failed. Until then further messages are
+ * rejected.
+ */
+extern void
+can_isotp_set_buffer(can_isotp_t *link, uint8_t *buffer, uint16_t size);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	Pass a received message to the connection
+ *
+ * \return	true if the message belongs to the connection
+ */
+extern bool
+can_isotp_handle_message(can_isotp_t *link, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	Send pending consecutive and flow control frames
+ *
+ * Should be called as often as possible. If the peer allows it (STmin = 0)
+ * as many frames are sent as fit into the transmit buffers.
+ */
+extern void
+can_isotp_process(can_isotp_t *link);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_isotp
+ * \brief	Time base for STmin and the timeouts
+ *
+ * Has to be called every millisecond, but not from an interrupt.
+ */
+extern void
+can_isotp_tick(can_isotp_t *link);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif	// CAN_ISOTP_H
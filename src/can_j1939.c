@@ -0,0 +1,550 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_j1939.h"
+#include "can_private.h"
+
+#include <avr/pgmspace.h>
+#include <string.h>
+
+// ----------------------------------------------------------------------------
+// connection management (TP.CM)
+
+#define	TP_CM_RTS				16
+#define	TP_CM_CTS				17
+#define	TP_CM_EOMA				19
+#define	TP_CM_BAM				32
+#define	TP_CM_ABORT				255
+
+#define	ABORT_BUSY				1
+#define	ABORT_RESOURCES			2
+#define	ABORT_TIMEOUT			3
+#define	ABORT_BAD_SEQUENCE		7
+
+// timeouts in milliseconds
+#define	TIMEOUT_T1				750		// between two packets
+#define	TIMEOUT_T2				1250	// after a CTS
+#define	TIMEOUT_T3				1250	// after the last packet of a window
+#define	TIMEOUT_T4				1050	// after a CTS holding the connection
+
+#define	BAM_INTERVAL			50
+
+// session states
+#define	SESSION_FREE			0
+#define	SESSION_BAM				1
+#define	SESSION_CMDT			2
+#define	SESSION_WAIT_CTS		3
+#define	SESSION_SEND			4
+#define	SESSION_WAIT_EOMA		5
+
+// ----------------------------------------------------------------------------
+static bool _j1939_send_frame(can_j1939_t *node, uint8_t priority,
+		uint32_t pgn, uint8_t destination, const uint8_t *data, uint8_t length)
+{
+	can_t msg;
+	
+	msg.id = can_j1939_id(priority, pgn, destination, node->address);
+	msg.flags.rtr = 0;
+	_can_classic_frame(&msg);
+	msg.flags.extended = 1;
+	msg.length = length;
+	memcpy(msg.data, data, length);
+	
+	return (can_send_message(&msg) != 0);
+}
+
+// ----------------------------------------------------------------------------
+static bool _j1939_send_cm(can_j1939_t *node, uint8_t destination,
+		uint8_t control, uint16_t value, uint8_t b3, uint8_t b4, uint32_t pgn)
+{
+	uint8_t data[8];
+	
+	data[0] = control;
+	data[1] = value & 0xff;
+	data[2] = value >> 8;
+	data[3] = b3;
+	data[4] = b4;
+	data[5] = pgn & 0xff;
+	data[6] = (pgn >> 8) & 0xff;
+	data[7] = (pgn >> 16) & 0xff;
+	
+	return _j1939_send_frame(node, 7, J1939_PGN_TP_CM, destination, data, 8);
+}
+
+// ----------------------------------------------------------------------------
+static void _j1939_abort(can_j1939_t *node, uint8_t destination,
+		uint8_t reason, uint32_t pgn)
+{
+	// best effort, the other side will run into a timeout otherwise
+	_j1939_send_cm(node, destination, TP_CM_ABORT, 0xff00 | reason, 0xff, 0xff, pgn);
+}
+
+// ----------------------------------------------------------------------------
+static bool _j1939_dispatch(can_j1939_t *node, uint32_t pgn, uint8_t source,
+		const uint8_t *data, uint16_t length)
+{
+	const can_j1939_handler_t *handler = node->handler;
+	
+	for (uint8_t i = 0; i < node->handler_count; i++, handler++)
+	{
+		if (pgm_read_dword(&handler->pgn) == pgn)
+		{
+			can_j1939_function_t function =
+					(can_j1939_function_t) pgm_read_ptr(&handler->function);
+			
+			function(pgn, source, data, length);
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+// Find the receive session for a peer, or a free one if there is none.
+// A peer may run a broadcast (BAM) and a connection (CMDT) at the same
+// time, so both are kept in separate sessions.
+
+static can_j1939_rx_session_t *_j1939_rx_session(can_j1939_t *node,
+		uint8_t peer, bool broadcast, bool create)
+{
+	can_j1939_rx_session_t *unused = NULL;
+	
+	for (uint8_t i = 0; i < CAN_J1939_RX_SESSIONS; i++)
+	{
+		can_j1939_rx_session_t *rx = &node->rx[i];
+		
+		if (rx->state == SESSION_FREE) {
+			if (unused == NULL)
+				unused = rx;
+		}
+		else if (rx->peer == peer && (rx->state == SESSION_BAM) == broadcast) {
+			return rx;
+		}
+	}
+	
+	return (create) ? unused : NULL;
+}
+
+// ----------------------------------------------------------------------------
+static can_j1939_tx_session_t *_j1939_tx_session(can_j1939_t *node,
+		uint8_t peer, uint32_t pgn)
+{
+	for (uint8_t i = 0; i < CAN_J1939_TX_SESSIONS; i++)
+	{
+		can_j1939_tx_session_t *tx = &node->tx[i];
+		
+		if (tx->state != SESSION_FREE && tx->peer == peer && tx->pgn == pgn)
+			return tx;
+	}
+	
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+void can_j1939_init(can_j1939_t *node, uint8_t address,
+		const can_j1939_handler_t *handler, uint8_t count)
+{
+	memset(node, 0, sizeof(can_j1939_t));
+	
+	node->address = address;
+	node->handler = handler;
+	node->handler_count = count;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_j1939_send(can_j1939_t *node, uint8_t priority, uint32_t pgn,
+		uint8_t destination, const uint8_t *data, uint16_t length)
+{
+	if (length <= 8)
+	{
+		if (!_j1939_send_frame(node, priority, pgn, destination, data, length))
+			return 0;
+		
+		return 0xff;
+	}
+	
+	if (length > 1785)
+		return 0;
+	
+	for (uint8_t i = 0; i < CAN_J1939_TX_SESSIONS; i++)
+	{
+		can_j1939_tx_session_t *tx = &node->tx[i];
+		
+		if (tx->state != SESSION_FREE)
+			continue;
+		
+		uint8_t packets = (length + 6) / 7;
+		
+		if (destination == J1939_GLOBAL_ADDRESS)
+		{
+			if (!_j1939_send_cm(node, destination, TP_CM_BAM, length, packets, 0xff, pgn))
+				return 0;
+			
+			tx->state = SESSION_BAM;
+			tx->timer = BAM_INTERVAL;
+		}
+		else
+		{
+			// no limit for the number of packets per CTS
+			if (!_j1939_send_cm(node, destination, TP_CM_RTS, length, packets, 0xff, pgn))
+				return 0;
+			
+			tx->state = SESSION_WAIT_CTS;
+			tx->timer = TIMEOUT_T3;
+		}
+		
+		tx->peer = destination;
+		tx->priority = priority;
+		tx->packets = packets;
+		tx->sequence = 1;
+		tx->length = length;
+		tx->pgn = pgn;
+		tx->data = data;
+		tx->result = J1939_BUSY;
+		
+		return i + 1;
+	}
+	
+	return 0;
+}
+
+// ----------------------------------------------------------------------------
+can_j1939_result_t can_j1939_result(const can_j1939_t *node, uint8_t handle)
+{
+	if (handle == 0 || handle > CAN_J1939_TX_SESSIONS)
+		return J1939_DONE;
+	
+	return node->tx[handle - 1].result;
+}
+
+// ----------------------------------------------------------------------------
+static void _j1939_tp_cm(can_j1939_t *node, uint8_t source,
+		uint8_t destination, const can_t *msg)
+{
+	const uint8_t *data = msg->data;
+	
+	if (msg->length < 8)
+		return;
+	
+	uint32_t pgn = data[5] | ((uint16_t) data[6] << 8) | ((uint32_t) data[7] << 16);
+	uint16_t length = data[1] | ((uint16_t) data[2] << 8);
+	
+	can_j1939_rx_session_t *rx;
+	can_j1939_tx_session_t *tx;
+	
+	switch (data[0])
+	{
+		case TP_CM_RTS:
+		case TP_CM_BAM:
+			if ((data[0] == TP_CM_BAM) != (destination == J1939_GLOBAL_ADDRESS))
+				break;
+			
+			rx = _j1939_rx_session(node, source, data[0] == TP_CM_BAM, true);
+			if (rx == NULL || length > CAN_J1939_MAX_LENGTH ||
+					data[3] != (length + 6) / 7)
+			{
+				if (data[0] == TP_CM_RTS)
+					_j1939_abort(node, source, (rx == NULL) ? ABORT_BUSY : ABORT_RESOURCES, pgn);
+				break;
+			}
+			
+			rx->peer = source;
+			rx->pgn = pgn;
+			rx->length = length;
+			rx->packets = data[3];
+			rx->sequence = 1;
+			
+			if (data[0] == TP_CM_BAM) {
+				rx->state = SESSION_BAM;
+				rx->control = 0;
+				rx->timer = TIMEOUT_T1;
+			}
+			else {
+				rx->state = SESSION_CMDT;
+				rx->cts_max = data[4];
+				rx->control = TP_CM_CTS;
+				rx->timer = TIMEOUT_T2;
+			}
+			break;
+		
+		case TP_CM_CTS:
+			tx = _j1939_tx_session(node, source, pgn);
+			if (tx == NULL || tx->state == SESSION_BAM)
+				break;
+			
+			if (data[1] == 0) {
+				// receiver holds the connection open
+				tx->state = SESSION_WAIT_CTS;
+				tx->timer = TIMEOUT_T4;
+			}
+			else if (data[2] == 0 || data[2] > tx->packets) {
+				_j1939_abort(node, source, ABORT_BAD_SEQUENCE, pgn);
+				tx->result = J1939_ABORTED;
+				tx->state = SESSION_FREE;
+			}
+			else {
+				uint8_t last = data[2] + data[1] - 1;
+				if (last > tx->packets || last < data[2])
+					last = tx->packets;
+				
+				tx->sequence = data[2];
+				tx->window_end = last;
+				tx->timer = 0;
+				tx->state = SESSION_SEND;
+			}
+			break;
+		
+		case TP_CM_EOMA:
+			tx = _j1939_tx_session(node, source, pgn);
+			if (tx != NULL && tx->state != SESSION_BAM) {
+				tx->result = J1939_DONE;
+				tx->state = SESSION_FREE;
+			}
+			break;
+		
+		case TP_CM_ABORT:
+			tx = _j1939_tx_session(node, source, pgn);
+			if (tx != NULL) {
+				tx->result = J1939_ABORTED;
+				tx->state = SESSION_FREE;
+			}
+			
+			// a broadcast can't be aborted
+			rx = _j1939_rx_session(node, source, false, false);
+			if (rx != NULL && rx->pgn == pgn) {
+				rx->control = 0;
+				rx->state = SESSION_FREE;
+			}
+			break;
+		
+		default:
+			break;
+	}
+}
+
+// ----------------------------------------------------------------------------
+static void _j1939_tp_dt(can_j1939_t *node, uint8_t source,
+		uint8_t destination, const can_t *msg)
+{
+	can_j1939_rx_session_t *rx = _j1939_rx_session(node, source,
+			destination == J1939_GLOBAL_ADDRESS, false);
+	
+	if (rx == NULL || msg->length < 2 || rx->control == TP_CM_EOMA)
+		return;
+	
+	uint8_t sequence = msg->data[0];
+	if (sequence != rx->sequence || sequence > rx->packets)
+	{
+		if (rx->state == SESSION_CMDT)
+			_j1939_abort(node, source, ABORT_BAD_SEQUENCE, rx->pgn);
+		
+		rx->control = 0;
+		rx->state = SESSION_FREE;
+		return;
+	}
+	
+	// copy the data directly to its position in the buffer
+	uint16_t offset = (uint16_t) (sequence - 1) * 7;
+	uint8_t length = (rx->length - offset > 7) ? 7 : rx->length - offset;
+	if (length > msg->length - 1)
+		length = msg->length - 1;
+	
+	memcpy(rx->buffer + offset, msg->data + 1, length);
+	rx->sequence++;
+	rx->timer = TIMEOUT_T1;
+	
+	if (sequence == rx->packets)
+	{
+		_j1939_dispatch(node, rx->pgn, source, rx->buffer, rx->length);
+		
+		if (rx->state == SESSION_CMDT) {
+			rx->control = TP_CM_EOMA;
+		}
+		else {
+			rx->control = 0;
+			rx->state = SESSION_FREE;
+		}
+	}
+	else if (rx->state == SESSION_CMDT && sequence == rx->window_end)
+	{
+		rx->control = TP_CM_CTS;
+		rx->timer = TIMEOUT_T2;
+	}
+}
+
+// ----------------------------------------------------------------------------
+bool can_j1939_handle_message(can_j1939_t *node, const can_t *msg)
+{
+	if (!msg->flags.extended || msg->flags.rtr)
+		return false;
+	
+	uint8_t source = can_j1939_source(msg->id);
+	uint8_t destination = can_j1939_destination(msg->id);
+	
+	if (source == node->address)
+		return false;
+	
+	if (destination != node->address && destination != J1939_GLOBAL_ADDRESS)
+		return false;
+	
+	uint32_t pgn = can_j1939_pgn(msg->id);
+	
+	if (pgn == J1939_PGN_TP_CM)
+		_j1939_tp_cm(node, source, destination, msg);
+	else if (pgn == J1939_PGN_TP_DT)
+		_j1939_tp_dt(node, source, destination, msg);
+	else
+		return _j1939_dispatch(node, pgn, source, msg->data, msg->length);
+	
+	// answer immediately if possible
+	can_j1939_process(node);
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+static bool _j1939_send_packet(can_j1939_t *node, can_j1939_tx_session_t *tx)
+{
+	uint8_t data[8];
+	uint16_t offset = (uint16_t) (tx->sequence - 1) * 7;
+	uint8_t length = (tx->length - offset > 7) ? 7 : tx->length - offset;
+	
+	data[0] = tx->sequence;
+	memcpy(data + 1, tx->data + offset, length);
+	memset(data + 1 + length, 0xff, 7 - length);
+	
+	if (!_j1939_send_frame(node, 7, J1939_PGN_TP_DT, tx->peer, data, 8))
+		return false;
+	
+	tx->sequence++;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void can_j1939_process(can_j1939_t *node)
+{
+	for (uint8_t i = 0; i < CAN_J1939_RX_SESSIONS; i++)
+	{
+		can_j1939_rx_session_t *rx = &node->rx[i];
+		
+		if (rx->control == TP_CM_CTS)
+		{
+			// request all remaining packets, unless the sender limits it
+			uint8_t count = rx->packets - rx->sequence + 1;
+			if (count > rx->cts_max)
+				count = rx->cts_max;
+			
+			if (_j1939_send_cm(node, rx->peer, TP_CM_CTS,
+					((uint16_t) rx->sequence << 8) | count, 0xff, 0xff, rx->pgn))
+			{
+				rx->window_end = rx->sequence + count - 1;
+				rx->control = 0;
+			}
+		}
+		else if (rx->control == TP_CM_EOMA)
+		{
+			if (_j1939_send_cm(node, rx->peer, TP_CM_EOMA, rx->length,
+					rx->packets, 0xff, rx->pgn))
+			{
+				rx->control = 0;
+				rx->state = SESSION_FREE;
+			}
+		}
+	}
+	
+	for (uint8_t i = 0; i < CAN_J1939_TX_SESSIONS; i++)
+	{
+		can_j1939_tx_session_t *tx = &node->tx[i];
+		
+		if (tx->state == SESSION_BAM && tx->timer == 0)
+		{
+			if (_j1939_send_packet(node, tx))
+			{
+				if (tx->sequence > tx->packets) {
+					tx->result = J1939_DONE;
+					tx->state = SESSION_FREE;
+				}
+				else {
+					tx->timer = BAM_INTERVAL;
+				}
+			}
+		}
+		else if (tx->state == SESSION_SEND)
+		{
+			// send the whole window as fast as possible
+			while (tx->sequence <= tx->window_end) {
+				if (!_j1939_send_packet(node, tx))
+					break;
+			}
+			
+			if (tx->sequence > tx->window_end)
+			{
+				tx->state = (tx->sequence > tx->packets) ?
+						SESSION_WAIT_EOMA : SESSION_WAIT_CTS;
+				tx->timer = TIMEOUT_T3;
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+void can_j1939_tick(can_j1939_t *node)
+{
+	for (uint8_t i = 0; i < CAN_J1939_RX_SESSIONS; i++)
+	{
+		can_j1939_rx_session_t *rx = &node->rx[i];
+		
+		if (rx->state != SESSION_FREE && --rx->timer == 0)
+		{
+			if (rx->state == SESSION_CMDT)
+				_j1939_abort(node, rx->peer, ABORT_TIMEOUT, rx->pgn);
+			
+			rx->control = 0;
+			rx->state = SESSION_FREE;
+		}
+	}
+	
+	for (uint8_t i = 0; i < CAN_J1939_TX_SESSIONS; i++)
+	{
+		can_j1939_tx_session_t *tx = &node->tx[i];
+		
+		if (tx->timer == 0 || --tx->timer != 0)
+			continue;
+		
+		if (tx->state == SESSION_WAIT_CTS || tx->state == SESSION_WAIT_EOMA)
+		{
+			_j1939_abort(node, tx->peer, ABORT_TIMEOUT, tx->pgn);
+			
+			tx->result = J1939_TIMEOUT;
+			tx->state = SESSION_FREE;
+		}
+	}
+}
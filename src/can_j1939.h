@@ -0,0 +1,328 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+/**
+ * \file	can_j1939.h
+ * \brief	SAE J1939 identifiers, PGN dispatch and transport protocol
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	CAN_J1939_H
+#define	CAN_J1939_H
+
+#if defined (__cplusplus)
+	extern "C" {
+#endif
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup		communication
+ * \defgroup	can_j1939 J1939
+ * \brief		Decoding of J1939 identifiers, dispatch of received messages by
+ *				their PGN and the transport protocol (BAM and RTS/CTS)
+ *
+ * Received messages are passed to the handler registered for their PGN in
+ * a table in flash. Messages longer than 8 bytes are sent and received
+ * with the transport protocol, several sessions can run at the same time.
+ *
+ * \code
+ * static void engine_speed(uint32_t pgn, uint8_t source,
+ *         const uint8_t *data, uint16_t length)
+ * {
+ *     ...
+ * }
+ *
+ * const can_j1939_handler_t handlers[] PROGMEM = {
+ *     { 61444, engine_speed },
+ *     ...
+ * };
+ *
+ * can_j1939_t node;
+ * can_j1939_init(&node, 0x80, handlers, sizeof(handlers) / sizeof(handlers[0]));
+ *
+ * while (1)
+ * {
+ *     can_t msg;
+ *     if (can_get_message(&msg))
+ *         can_j1939_handle_message(&node, &msg);
+ *
+ *     if (millisecond_elapsed)
+ *         can_j1939_tick(&node);
+ *
+ *     can_j1939_process(&node);
+ * }
+ * \endcode
+ */
+// ----------------------------------------------------------------------------
+
+#include "can.h"
+
+#if !SUPPORT_EXTENDED_CANID
+	#error	J1939 needs SUPPORT_EXTENDED_CANID
+#endif
+
+/**
+ * \ingroup	can_j1939
+ * \name	Settings
+ */
+//@{
+#ifndef	CAN_J1939_RX_SESSIONS
+	/// number of messages received at the same time with the transport protocol,
+	/// a broadcast and a connection from the same node need one session each
+	#define	CAN_J1939_RX_SESSIONS	1
+#endif
+
+#ifndef	CAN_J1939_TX_SESSIONS
+	/// number of messages sent at the same time with the transport protocol
+	#define	CAN_J1939_TX_SESSIONS	1
+#endif
+
+#ifndef	CAN_J1939_MAX_LENGTH
+	/// size of the buffer of every receive session (9 .. 1785 bytes)
+	#define	CAN_J1939_MAX_LENGTH	64
+#endif
+//@}
+
+/**
+ * \ingroup	can_j1939
+ * \name	Addresses and PGNs
+ */
+//@{
+#define	J1939_GLOBAL_ADDRESS	0xff
+#define	J1939_NULL_ADDRESS		0xfe
+
+#define	J1939_PGN_REQUEST		0xea00
+#define	J1939_PGN_TP_DT			0xeb00
+#define	J1939_PGN_TP_CM			0xec00
+//@}
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \name	Decoding of the 29 bit identifier
+ *
+ * Layout: priority (3), EDP/DP (2), PDU format (8), PDU specific (8),
+ * source address (8). The fields are byte aligned so no 32 bit shifts are
+ * needed.
+ */
+//@{
+static inline uint8_t can_j1939_priority(uint32_t id)
+{
+	return ((uint8_t) (id >> 24) >> 2) & 0x07;
+}
+
+static inline uint8_t can_j1939_source(uint32_t id)
+{
+	return (uint8_t) id;
+}
+
+/// PDU format < 240 => PDU specific contains the destination address
+static inline uint8_t can_j1939_destination(uint32_t id)
+{
+	if ((uint8_t) (id >> 16) < 240)
+		return (uint8_t) (id >> 8);
+	else
+		return J1939_GLOBAL_ADDRESS;
+}
+
+static inline uint32_t can_j1939_pgn(uint32_t id)
+{
+	uint32_t pgn = (id >> 8) & 0x3ffff;
+	
+	if ((uint8_t) (id >> 16) < 240)
+		pgn &= 0x3ff00;
+	
+	return pgn;
+}
+
+static inline uint32_t can_j1939_id(uint8_t priority, uint32_t pgn,
+		uint8_t destination, uint8_t source)
+{
+	uint32_t id = ((uint32_t) (priority & 0x07) << 26) | ((pgn & 0x3ffff) << 8) | source;
+	
+	if ((uint8_t) (pgn >> 8) < 240)
+		id = (id & ~0xff00UL) | ((uint16_t) destination << 8);
+	
+	return id;
+}
+//@}
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	Function called for a received message
+ */
+typedef void (*can_j1939_function_t)(uint32_t pgn, uint8_t source,
+		const uint8_t *data, uint16_t length);
+
+/**
+ * \ingroup	can_j1939
+ * \brief	Entry of the dispatch table (stored in flash)
+ */
+typedef struct {
+	uint32_t pgn;
+	can_j1939_function_t function;
+} can_j1939_handler_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	Result of a transmission
+ */
+typedef enum {
+	J1939_DONE,			//!< message sent (or session not used yet)
+	J1939_BUSY,			//!< transmission in progress
+	J1939_ABORTED,		//!< aborted by the receiver
+	J1939_TIMEOUT		//!< receiver didn't answer in time
+} can_j1939_result_t;
+
+typedef struct {
+	uint8_t state;
+	uint8_t peer;
+	uint8_t control;			// TP.CM frame to send, 0 => nothing
+	uint8_t packets;
+	uint8_t sequence;			// next packet
+	uint8_t window_end;			// last packet allowed by the CTS
+	uint8_t cts_max;			// maximum number of packets per CTS
+	uint16_t length;
+	uint16_t timer;
+	uint32_t pgn;
+	uint8_t buffer[CAN_J1939_MAX_LENGTH];
+} can_j1939_rx_session_t;
+
+typedef struct {
+	uint8_t state;
+	uint8_t peer;
+	uint8_t priority;
+	uint8_t packets;
+	uint8_t sequence;
+	uint8_t window_end;
+	uint16_t length;
+	uint16_t timer;
+	uint32_t pgn;
+	const uint8_t *data;
+	can_j1939_result_t result;
+} can_j1939_tx_session_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	Local node
+ */
+typedef struct {
+	uint8_t address;			//!< own source address
+	const can_j1939_handler_t *handler;
+	uint8_t handler_count;
+	
+	can_j1939_rx_session_t rx[CAN_J1939_RX_SESSIONS];
+	can_j1939_tx_session_t tx[CAN_J1939_TX_SESSIONS];
+} can_j1939_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	Initialize a node
+ *
+ * \param	node		Node
+ * \param	address		Own source address
+ * \param	handler		Dispatch table in flash (PROGMEM)
+ * \param	count		Number of entries in the table
+ */
+extern void
+can_j1939_init(can_j1939_t *node, uint8_t address,
+		const can_j1939_handler_t *handler, uint8_t count);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	Send a message
+ *
+ * Messages up to 8 bytes are sent directly. Longer messages use the
+ * transport protocol: BAM for the global address, otherwise RTS/CTS. The
+ * data is not copied and has to stay valid until the transmission is
+ * finished, see can_j1939_result().
+ *
+ * BAM packets are sent every 50 ms (the minimum allowed), with RTS/CTS
+ * all packets allowed by the receiver are sent as fast as the transmit
+ * buffers accept them.
+ *
+ * \return	0 if the message could not be sent, otherwise a handle for
+ *			can_j1939_result()
+ */
+extern uint8_t
+can_j1939_send(can_j1939_t *node, uint8_t priority, uint32_t pgn,
+		uint8_t destination, const uint8_t *data, uint16_t length);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	State of a transmission started by can_j1939_send()
+ */
+extern can_j1939_result_t
+can_j1939_result(const can_j1939_t *node, uint8_t handle);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	Pass a received message to the node
+ *
+ * Messages for the node or the global address are passed to the handler
+ * of their PGN, messages of the transport protocol after they are
+ * complete.
+ *
+ * \return	false if the message is not a J1939 message for this node
+ */
+extern bool
+can_j1939_handle_message(can_j1939_t *node, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	Send pending frames of the transport protocol
+ *
+ * Should be called as often as possible.
+ */
+extern void
+can_j1939_process(can_j1939_t *node);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_j1939
+ * \brief	Time base for the transport protocol
+ *
+ * Has to be called every millisecond, but not from an interrupt.
+ */
+extern void
+can_j1939_tick(can_j1939_t *node);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif	// CAN_J1939_H
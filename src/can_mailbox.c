@@ -0,0 +1,114 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_private.h"
+#include "utils.h"
+
+#if CAN_MAILBOX_SLOTS > 0
+
+typedef struct {
+	can_filter_t filter;
+	can_t msg;
+	uint8_t sequence;		//!< 0 => disabled or nothing received yet
+	bool valid;
+} can_mailbox_t;
+
+static can_mailbox_t _can_mailbox_list[CAN_MAILBOX_SLOTS];
+
+// ----------------------------------------------------------------------------
+bool can_set_mailbox(uint8_t number, const can_filter_t *filter)
+{
+	if (number >= CAN_MAILBOX_SLOTS)
+		return false;
+	
+	can_mailbox_t *mailbox = &_can_mailbox_list[number];
+	
+	// disable the mailbox while it is changed
+	CAN_ENTER_CRITICAL_SECTION;
+	mailbox->valid = false;
+	mailbox->sequence = 0;
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	if (filter != NULL)
+	{
+		mailbox->filter = *filter;
+		
+		CAN_ENTER_CRITICAL_SECTION;
+		mailbox->valid = true;
+		CAN_LEAVE_CRITICAL_SECTION;
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_get_mailbox(uint8_t number, can_t *msg)
+{
+	uint8_t sequence = 0;
+	
+	if (number >= CAN_MAILBOX_SLOTS)
+		return 0;
+	
+	can_mailbox_t *mailbox = &_can_mailbox_list[number];
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	sequence = mailbox->sequence;
+	if (sequence != 0)
+		*msg = mailbox->msg;
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	return sequence;
+}
+
+// ----------------------------------------------------------------------------
+bool _can_mailbox_update(const can_t *msg)
+{
+	can_mailbox_t *mailbox = _can_mailbox_list;
+	
+	for (uint8_t i = 0; i < CAN_MAILBOX_SLOTS; i++, mailbox++)
+	{
+		if (!mailbox->valid || !_can_filter_match(&mailbox->filter, msg))
+			continue;
+		
+		CAN_ENTER_CRITICAL_SECTION;
+		mailbox->msg = *msg;
+		
+		// 0 is reserved for empty mailboxes
+		if (++mailbox->sequence == 0)
+			mailbox->sequence = 1;
+		CAN_LEAVE_CRITICAL_SECTION;
+		
+		return true;
+	}
+	
+	return false;
+}
+
+#endif
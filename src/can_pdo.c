@@ -0,0 +1,187 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_pdo.h"
+#include "can_private.h"
+
+// periodic MObs are only available on the AT90CAN
+#if CAN_PERIODIC_MOBS > 0 && BUILD_FOR_AT90CAN
+	#define	PDO_PERIODIC	1
+#else
+	#define	PDO_PERIODIC	0
+#endif
+
+// ----------------------------------------------------------------------------
+static void _pdo_prepare(const can_tpdo_t *tpdo, can_t *msg)
+{
+	msg->id = tpdo->id;
+	msg->flags.rtr = 0;
+	_can_classic_frame(msg);
+	#if SUPPORT_EXTENDED_CANID
+	msg->flags.extended = 0;
+	#endif
+	
+	msg->length = tpdo->pack(msg->data);
+}
+
+// ----------------------------------------------------------------------------
+bool can_tpdo_init(can_tpdo_t *tpdo)
+{
+	tpdo->counter = 0;
+	
+	#if PDO_PERIODIC
+	if (tpdo->periodic != CAN_PDO_NO_PERIODIC)
+	{
+		can_t msg;
+		
+		_pdo_prepare(tpdo, &msg);
+		memcpy(tpdo->data, msg.data, 8);
+		
+		return can_set_periodic_message(tpdo->periodic, &msg);
+	}
+	#endif
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+bool can_tpdo_send(can_tpdo_t *tpdo)
+{
+	#if PDO_PERIODIC
+	if (tpdo->periodic != CAN_PDO_NO_PERIODIC)
+	{
+		uint8_t data[8];
+		uint8_t changed = 0;
+		uint8_t length = tpdo->pack(data);
+		
+		// only the changed bytes have to be written to the MOb
+		for (uint8_t i = 0; i < length; i++) {
+			if (data[i] != tpdo->data[i])
+				changed |= (1 << i);
+		}
+		
+		if (!can_send_periodic_message(tpdo->periodic, data, changed))
+			return false;
+		
+		memcpy(tpdo->data, data, length);
+		return true;
+	}
+	#endif
+	
+	can_t msg;
+	_pdo_prepare(tpdo, &msg);
+	
+	return (can_send_message(&msg) != 0);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_pdo_sync(can_tpdo_t *tpdo, uint8_t count)
+{
+	uint8_t failed = 0;
+	
+	for (uint8_t i = 0; i < count; i++, tpdo++)
+	{
+		if (tpdo->type == 0 || tpdo->type > 240)
+			continue;
+		
+		if (++tpdo->counter < tpdo->type)
+			continue;
+		
+		tpdo->counter = 0;
+		if (!can_tpdo_send(tpdo))
+			failed++;
+	}
+	
+	return failed;
+}
+
+// ----------------------------------------------------------------------------
+bool can_rpdo_handle_message(const can_rpdo_t *rpdo, uint8_t count, const can_t *msg)
+{
+	if (msg->flags.rtr)
+		return false;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if (msg->flags.extended)
+		return false;
+	#endif
+	
+	for (uint8_t i = 0; i < count; i++, rpdo++)
+	{
+		if (pgm_read_word(&rpdo->id) == msg->id)
+		{
+			can_pdo_unpack_t unpack = (can_pdo_unpack_t) pgm_read_ptr(&rpdo->unpack);
+			
+			unpack(msg->data, msg->length);
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t can_pdo_pack(const can_pdo_entry_t *table, uint8_t count, uint8_t *data)
+{
+	uint8_t length = 0;
+	
+	for (uint8_t i = 0; i < count; i++, table++)
+	{
+		uint8_t offset = pgm_read_byte(&table->offset);
+		uint8_t size = pgm_read_byte(&table->size);
+		
+		memcpy(data + offset, pgm_read_ptr(&table->variable), size);
+		
+		if (offset + size > length)
+			length = offset + size;
+	}
+	
+	return length;
+}
+
+// ----------------------------------------------------------------------------
+void can_pdo_unpack(const can_pdo_entry_t *table, uint8_t count,
+		const uint8_t *data, uint8_t length)
+{
+	// PDOs shorter than the mapping are ignored
+	for (uint8_t i = 0; i < count; i++)
+	{
+		if (pgm_read_byte(&table[i].offset) + pgm_read_byte(&table[i].size) > length)
+			return;
+	}
+	
+	for (uint8_t i = 0; i < count; i++, table++)
+	{
+		uint8_t offset = pgm_read_byte(&table->offset);
+		uint8_t size = pgm_read_byte(&table->size);
+		
+		memcpy(pgm_read_ptr(&table->variable), data + offset, size);
+	}
+}
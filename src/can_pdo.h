@@ -0,0 +1,283 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+/**
+ * \file	can_pdo.h
+ * \brief	CANopen PDO mapping
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	CAN_PDO_H
+#define	CAN_PDO_H
+
+#if defined (__cplusplus)
+	extern "C" {
+#endif
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup		communication
+ * \defgroup	can_pdo CANopen PDOs
+ * \brief		Mapping of variables to PDOs
+ *
+ * A mapping is a list of variables and their byte offsets in the PDO. The
+ * list is given as a macro and expanded at compile time into functions
+ * which copy every variable with a fixed size to a fixed position, so no
+ * table has to be interpreted at runtime. CANopen uses little endian like
+ * the AVR, the variables are copied unchanged.
+ *
+ * \code
+ * #define MOTOR_STATUS(ENTRY) \
+ *     ENTRY(motor_speed, 0) \
+ *     ENTRY(motor_current, 2) \
+ *     ENTRY(motor_state, 4)
+ *
+ * CAN_PDO_PACK_FUNCTION(motor_status_pack, MOTOR_STATUS)
+ *
+ * #define MOTOR_COMMAND(ENTRY) \
+ *     ENTRY(target_speed, 0)
+ *
+ * CAN_PDO_UNPACK_FUNCTION(motor_command_unpack, MOTOR_COMMAND)
+ *
+ * // sent with every SYNC
+ * can_tpdo_t tpdo[] = {
+ *     { 0x181, 1, CAN_PDO_NO_PERIODIC, motor_status_pack }
+ * };
+ *
+ * const can_rpdo_t rpdo[] PROGMEM = {
+ *     { 0x201, motor_command_unpack }
+ * };
+ *
+ * can_tpdo_init(&tpdo[0]);
+ * ...
+ * if (can_get_message(&msg))
+ * {
+ *     if (msg.id == CAN_PDO_SYNC_ID)
+ *         can_pdo_sync(tpdo, 1);
+ *     else
+ *         can_rpdo_handle_message(rpdo, 1, &msg);
+ * }
+ * \endcode
+ */
+// ----------------------------------------------------------------------------
+
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "can.h"
+
+/// COB-ID of the SYNC message
+#define	CAN_PDO_SYNC_ID			0x080
+
+/// value for can_tpdo_t::periodic if no periodic MOb is used
+#define	CAN_PDO_NO_PERIODIC		0xff
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \name	Generation of the mapping functions
+ */
+//@{
+
+// a variable beyond the 8 bytes of a PDO gives a negative array size
+#define	_CAN_PDO_CHECK(variable, offset) \
+			(void) sizeof(char[((offset) + sizeof(variable) <= 8) ? 1 : -1]);
+
+#define	_CAN_PDO_PACK(variable, offset) \
+			_CAN_PDO_CHECK(variable, offset) \
+			memcpy(data + (offset), &(variable), sizeof(variable)); \
+			if ((offset) + sizeof(variable) > length) \
+				length = (offset) + sizeof(variable);
+
+#define	_CAN_PDO_LENGTH(variable, offset) \
+			if ((offset) + sizeof(variable) > length) \
+				length = (offset) + sizeof(variable);
+
+#define	_CAN_PDO_UNPACK(variable, offset) \
+			_CAN_PDO_CHECK(variable, offset) \
+			memcpy(&(variable), data + (offset), sizeof(variable));
+
+#define	_CAN_PDO_TABLE(variable, offset) \
+			{ &(variable), (offset), sizeof(variable) },
+
+/**
+ * \brief	Create the function \a name which copies the variables of
+ *			\a mapping into a PDO and returns its length
+ *
+ * A mapping which exceeds the 8 bytes of the PDO fails to compile.
+ */
+#define	CAN_PDO_PACK_FUNCTION(name, mapping) \
+	static uint8_t name(uint8_t *data) \
+	{ \
+		uint8_t length = 0; \
+		mapping(_CAN_PDO_PACK) \
+		return length; \
+	}
+
+/**
+ * \brief	Create the function \a name which copies a received PDO to the
+ *			variables of \a mapping
+ *
+ * PDOs shorter than the mapping are ignored.
+ */
+#define	CAN_PDO_UNPACK_FUNCTION(name, mapping) \
+	static void name(const uint8_t *data, uint8_t received) \
+	{ \
+		uint8_t length = 0; \
+		mapping(_CAN_PDO_LENGTH) \
+		if (received < length) \
+			return; \
+		mapping(_CAN_PDO_UNPACK) \
+	}
+
+/**
+ * \brief	Create a table of the mapping in flash, e.g. for the object
+ *			dictionary or for can_pdo_pack() and can_pdo_unpack()
+ */
+#define	CAN_PDO_TABLE(name, mapping) \
+	const can_pdo_entry_t name[] PROGMEM = { mapping(_CAN_PDO_TABLE) };
+//@}
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \brief	Entry of a mapping table
+ */
+typedef struct {
+	void *variable;
+	uint8_t offset;
+	uint8_t size;
+} can_pdo_entry_t;
+
+typedef uint8_t (*can_pdo_pack_t)(uint8_t *data);
+typedef void (*can_pdo_unpack_t)(const uint8_t *data, uint8_t length);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \brief	Transmit PDO
+ */
+typedef struct {
+	uint16_t id;				//!< COB-ID
+	uint8_t type;				//!< 1..240 => sent with every n-th SYNC, 0 => only by can_tpdo_send()
+	uint8_t periodic;			//!< number of the periodic MOb (AT90CAN) or CAN_PDO_NO_PERIODIC
+	can_pdo_pack_t pack;		//!< function created with CAN_PDO_PACK_FUNCTION()
+	
+	uint8_t counter;
+	#if CAN_PERIODIC_MOBS > 0
+	uint8_t data[8];			// content of the periodic MOb
+	#endif
+} can_tpdo_t;
+
+/**
+ * \ingroup	can_pdo
+ * \brief	Receive PDO (stored in flash)
+ */
+typedef struct {
+	uint16_t id;				//!< COB-ID
+	can_pdo_unpack_t unpack;	//!< function created with CAN_PDO_UNPACK_FUNCTION()
+} can_rpdo_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \brief	Prepare a transmit PDO
+ *
+ * If a periodic MOb is used the PDO is loaded with
+ * can_set_periodic_message(). Every transmission afterwards only updates
+ * the bytes which have changed.
+ */
+extern bool
+can_tpdo_init(can_tpdo_t *tpdo);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \brief	Send a transmit PDO with the current values of its variables
+ */
+extern bool
+can_tpdo_send(can_tpdo_t *tpdo);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \brief	Handle a received SYNC message
+ *
+ * Sends every PDO whose transmission type is due.
+ *
+ * \return	number of PDOs which could not be sent
+ */
+extern uint8_t
+can_pdo_sync(can_tpdo_t *tpdo, uint8_t count);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \brief	Pass a received message to the receive PDOs
+ *
+ * \param	rpdo	Table in flash
+ * \param	count	Number of entries
+ * \param	msg		Received message
+ * \return	true if the message was a PDO of the table
+ */
+extern bool
+can_rpdo_handle_message(const can_rpdo_t *rpdo, uint8_t count, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \brief	Pack a PDO using a table created with CAN_PDO_TABLE()
+ *
+ * Slower than the functions created with CAN_PDO_PACK_FUNCTION(), but the
+ * table may be selected at runtime.
+ *
+ * \return	length of the PDO
+ */
+extern uint8_t
+can_pdo_pack(const can_pdo_entry_t *table, uint8_t count, uint8_t *data);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_pdo
+ * \brief	Unpack a PDO using a table created with CAN_PDO_TABLE()
+ *
+ * PDOs shorter than the mapping are ignored, the same as with the
+ * functions created with CAN_PDO_UNPACK_FUNCTION().
+ *
+ * \param	length	Length of the received PDO
+ */
+extern void
+can_pdo_unpack(const can_pdo_entry_t *table, uint8_t count,
+		const uint8_t *data, uint8_t length);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif	// CAN_PDO_H
@@ -31,6 +31,8 @@
 #ifndef	CAN_PRIVATE_H
 #define	CAN_PRIVATE_H
 
+#include <avr/io.h>
+
 #include "can.h"
 
 #ifndef	CAN_FORCE_TX_ORDER
@@ -50,6 +52,94 @@
 	#define	CAN_RX_BUFFER_SIZE		0
 #endif
 
+// sort the transmit buffer by the priority of the messages
+#ifndef	CAN_TX_PRIORITY_QUEUE
+	#define	CAN_TX_PRIORITY_QUEUE	0
+#endif
+
+#if CAN_TX_BUFFER_SIZE == 0
+	#undef	CAN_TX_PRIORITY_QUEUE
+	#define	CAN_TX_PRIORITY_QUEUE	0
+#endif
+
+// discard buffered messages after a deadline (only for the AT90CAN)
+#ifndef	CAN_TX_DEADLINE
+	#define	CAN_TX_DEADLINE			0
+#endif
+
+#if CAN_TX_DEADLINE && (CAN_TX_BUFFER_SIZE == 0 || !SUPPORT_TIMESTAMPS)
+	#error	CAN_TX_DEADLINE needs SUPPORT_TIMESTAMPS and CAN_TX_BUFFER_SIZE > 0
+#endif
+
+// number of MObs reserved for periodic messages (only for the AT90CAN)
+#ifndef	CAN_PERIODIC_MOBS
+	#define	CAN_PERIODIC_MOBS		0
+#endif
+
+// number of automatic replies to remote frames
+#ifndef	CAN_AUTO_REPLY_SLOTS
+	#define	CAN_AUTO_REPLY_SLOTS	0
+#endif
+
+// number of messages per tick above which the receive interrupt is
+// replaced by polling (only for the AT90CAN)
+#ifndef	CAN_RX_POLL_THRESHOLD
+	#define	CAN_RX_POLL_THRESHOLD	0
+#endif
+
+#if CAN_RX_POLL_THRESHOLD > 0 && CAN_RX_BUFFER_SIZE == 0
+	#error	CAN_RX_POLL_THRESHOLD needs CAN_RX_BUFFER_SIZE > 0
+#endif
+
+// number of mailboxes holding the latest message of an identifier
+#ifndef	CAN_MAILBOX_SLOTS
+	#define	CAN_MAILBOX_SLOTS		0
+#endif
+
+// number of filters suppressing unchanged messages
+#ifndef	CAN_CHANGE_FILTER_SLOTS
+	#define	CAN_CHANGE_FILTER_SLOTS	0
+#endif
+
+// accept only high priority messages into a nearly full buffer
+#ifndef	CAN_SHED_HIGH_WATERMARK
+	#define	CAN_SHED_HIGH_WATERMARK	0
+#endif
+
+#ifndef	CAN_SHED_LOW_WATERMARK
+	#define	CAN_SHED_LOW_WATERMARK	(CAN_SHED_HIGH_WATERMARK / 2)
+#endif
+
+#ifndef	CAN_SHED_PRIORITY_ID
+	#define	CAN_SHED_PRIORITY_ID	0x100
+#endif
+
+#if CAN_SHED_HIGH_WATERMARK > 0 && CAN_SHED_LOW_WATERMARK >= CAN_SHED_HIGH_WATERMARK
+	#error	CAN_SHED_LOW_WATERMARK has to be lower than CAN_SHED_HIGH_WATERMARK
+#endif
+
+// number of ID classes with a transmit rate limit
+#ifndef	CAN_RATE_LIMIT_CLASSES
+	#define	CAN_RATE_LIMIT_CLASSES	0
+#endif
+
+// FreeRTOS port (can_freertos.c)
+#ifndef	CAN_FREERTOS
+	#define	CAN_FREERTOS			0
+#endif
+
+#ifndef	CAN_SUBSCRIPTION_SLOTS
+	#define	CAN_SUBSCRIPTION_SLOTS	0
+#endif
+
+#ifndef	CAN_SUBSCRIPTION_QUEUE_SIZE
+	#define	CAN_SUBSCRIPTION_QUEUE_SIZE	4
+#endif
+
+#if CAN_SUBSCRIPTION_SLOTS > 0 && !CAN_FREERTOS
+	#error	CAN_SUBSCRIPTION_SLOTS needs CAN_FREERTOS
+#endif
+
 
 #if defined(SUPPORT_MCP2515) && (SUPPORT_MCP2515 == 1)
 	#define	BUILD_FOR_MCP2515	1
@@ -69,46 +159,125 @@
 	#define BUILD_FOR_SJA1000	0
 #endif
 
-#if ((BUILD_FOR_MCP2515 + BUILD_FOR_AT90CAN + BUILD_FOR_SJA1000) <= 1)
+#if defined(SUPPORT_MCP2517FD) && (SUPPORT_MCP2517FD == 1)
+	#define	BUILD_FOR_MCP2517FD	1
+#else
+	#define BUILD_FOR_MCP2517FD	0
+#endif
+
+#if CAN_FREERTOS
+	// the tasks wait for the receive interrupt
+	#if (BUILD_FOR_MCP2515 + BUILD_FOR_AT90CAN + BUILD_FOR_SJA1000 + BUILD_FOR_MCP2517FD) > 1
+		#error	CAN_FREERTOS is only possible for one controller
+	#elif !(BUILD_FOR_MCP2515 && defined(MCP2515_INT_VECTOR)) && \
+		  !(BUILD_FOR_AT90CAN && CAN_RX_BUFFER_SIZE > 0)
+		#error	CAN_FREERTOS needs MCP2515_INT_VECTOR or the AT90CAN with CAN_RX_BUFFER_SIZE > 0
+	#elif CAN_RX_POLL_THRESHOLD > 0
+		#error	CAN_RX_POLL_THRESHOLD is not possible with CAN_FREERTOS
+	#endif
+	
+	// every function which accesses the controller or the receive buffer
+	// is provided by the driver as _can_xxx(), the public can_xxx() takes
+	// the mutex first (see can_freertos.c)
+	#define	_CAN_LOCKED(function)	_##function
+	
+	extern uint8_t _can_send_message(const can_t *msg);
+	extern uint8_t _can_get_message(can_t *msg);
+	extern bool _can_check_free_buffer(void);
+	extern uint8_t _can_send_message_preemptive(const can_t *msg, can_t *aborted);
+	extern uint8_t _can_send_template(const can_template_t *tpl, const uint8_t *data);
+	extern uint8_t _can_send_timestamped_message(const can_t *msg);
+	extern can_error_register_t _can_read_error_register(void);
+	extern void _can_set_mode(can_mode_t mode);
+	extern void _can_set_one_shot(bool enable);
+	extern bool _can_set_filter(uint8_t number, const can_filter_t *filter);
+	extern uint8_t _can_get_filter(uint8_t number, can_filter_t *filter);
+	
+	// MCP2515
+	extern void _can_static_filter(const uint8_t *filter_array);
+	extern void _can_static_filter2(uint8_t *filter_array);
+	extern void _can_sleep(void);
+	extern void _can_wakeup(void);
+	
+	// AT90CAN
+	extern bool _can_disable_filter(uint8_t number);
+	extern uint8_t _can_send_message_deadline(const can_t *msg, uint16_t max_age);
+	extern uint8_t _can_send_latest_message(const can_t *msg);
+	extern bool _can_set_periodic_message(uint8_t number, const can_t *msg);
+	extern bool _can_send_periodic_message(uint8_t number, const uint8_t *data, uint8_t changed);
+	extern bool _can_set_auto_reply(uint8_t number, const can_t *msg);
+#else
+	#define	_CAN_LOCKED(function)	function
+#endif
+
+#define	_CAN_SEND_MESSAGE		_CAN_LOCKED(can_send_message)
+
+#if ((BUILD_FOR_MCP2515 + BUILD_FOR_AT90CAN + BUILD_FOR_SJA1000 + BUILD_FOR_MCP2517FD) <= 1)
 	#if (BUILD_FOR_MCP2515 == 1)
 
 		#define mcp2515_init(...)					can_init(__VA_ARGS__)
-		#define mcp2515_sleep(...)					can_sleep(__VA_ARGS__)
-		#define mcp2515_wakeup(...)					can_wakeup(__VA_ARGS__)
-		#define mcp2515_check_free_buffer(...)		can_check_free_buffer(__VA_ARGS__)
+		#define mcp2515_sleep(...)					_CAN_LOCKED(can_sleep)(__VA_ARGS__)
+		#define mcp2515_wakeup(...)					_CAN_LOCKED(can_wakeup)(__VA_ARGS__)
+		#define mcp2515_check_free_buffer(...)		_CAN_LOCKED(can_check_free_buffer)(__VA_ARGS__)
 		#define mcp2515_check_message(...)			can_check_message(__VA_ARGS__)
-		#define mcp2515_get_filter(...)				can_get_filter(__VA_ARGS__)
-		#define mcp2515_static_filter(...)			can_static_filter(__VA_ARGS__)
-		#define mcp2515_static_filter2(...)			can_static_filter2(__VA_ARGS__)
-		#define mcp2515_set_filter(...)				can_set_filter(__VA_ARGS__)
-		#define mcp2515_get_message(...)			can_get_message(__VA_ARGS__)
-		#define mcp2515_send_message(...)			can_send_message(__VA_ARGS__)
-		#define	mcp2515_read_error_register(...)	can_read_error_register(__VA_ARGS__)
-		#define	mcp2515_set_mode(...)				can_set_mode(__VA_ARGS__)
+		#define mcp2515_get_filter(...)				_CAN_LOCKED(can_get_filter)(__VA_ARGS__)
+		#define mcp2515_static_filter(...)			_CAN_LOCKED(can_static_filter)(__VA_ARGS__)
+		#define mcp2515_static_filter2(...)			_CAN_LOCKED(can_static_filter2)(__VA_ARGS__)
+		#define mcp2515_set_filter(...)				_CAN_LOCKED(can_set_filter)(__VA_ARGS__)
+		
+		#ifndef	MCP2515_INT_VECTOR
+			#define mcp2515_get_message(...)			_CAN_LOCKED(can_get_message)(__VA_ARGS__)
+		#else
+			#define	mcp2515_get_buffered_message(...)	_CAN_LOCKED(can_get_message)(__VA_ARGS__)
+		#endif
+		
+		#define mcp2515_send_message(...)			_CAN_SEND_MESSAGE(__VA_ARGS__)
+		#define	mcp2515_send_message_preemptive(...)	_CAN_LOCKED(can_send_message_preemptive)(__VA_ARGS__)
+		#define	mcp2515_prepare_template(...)		can_prepare_template(__VA_ARGS__)
+		#define	mcp2515_send_template(...)			_CAN_LOCKED(can_send_template)(__VA_ARGS__)
+		#define	mcp2515_read_error_register(...)	_CAN_LOCKED(can_read_error_register)(__VA_ARGS__)
+		#define	mcp2515_set_mode(...)				_CAN_LOCKED(can_set_mode)(__VA_ARGS__)
+		#define	mcp2515_set_one_shot(...)			_CAN_LOCKED(can_set_one_shot)(__VA_ARGS__)
+		#define	mcp2515_send_timestamped_message(...)	_CAN_LOCKED(can_send_timestamped_message)(__VA_ARGS__)
+		#define	mcp2515_get_tx_timestamp(...)		can_get_tx_timestamp(__VA_ARGS__)
+		#define	mcp2515_wait_message(...)			can_wait_message(__VA_ARGS__)
 
 	#elif (BUILD_FOR_AT90CAN == 1)
 
 		#define at90can_init(...)					can_init(__VA_ARGS__)
-		#define at90can_check_free_buffer(...)		can_check_free_buffer(__VA_ARGS__)
+		#define at90can_check_free_buffer(...)		_CAN_LOCKED(can_check_free_buffer)(__VA_ARGS__)
 		#define at90can_check_message(...)			can_check_message(__VA_ARGS__)
-		#define at90can_get_filter(...)				can_get_filter(__VA_ARGS__)
-		#define at90can_set_filter(...)				can_set_filter(__VA_ARGS__)
-		#define at90can_disable_filter(...)			can_disable_filter(__VA_ARGS__)
+		#define at90can_get_filter(...)				_CAN_LOCKED(can_get_filter)(__VA_ARGS__)
+		#define at90can_set_filter(...)				_CAN_LOCKED(can_set_filter)(__VA_ARGS__)
+		#define at90can_disable_filter(...)			_CAN_LOCKED(can_disable_filter)(__VA_ARGS__)
 		
 		#if CAN_RX_BUFFER_SIZE == 0
-			#define at90can_get_message(...)			can_get_message(__VA_ARGS__)
+			#define at90can_get_message(...)			_CAN_LOCKED(can_get_message)(__VA_ARGS__)
 		#else
-			#define	at90can_get_buffered_message(...)	can_get_message(__VA_ARGS__)
+			#define	at90can_get_buffered_message(...)	_CAN_LOCKED(can_get_message)(__VA_ARGS__)
 		#endif
 		
 		#if CAN_TX_BUFFER_SIZE == 0
-			#define at90can_send_message(...)			can_send_message(__VA_ARGS__)
+			#define at90can_send_message(...)			_CAN_SEND_MESSAGE(__VA_ARGS__)
 		#else
-			#define	at90can_send_buffered_message(...)	can_send_message(__VA_ARGS__)
+			#define	at90can_send_buffered_message(...)	_CAN_SEND_MESSAGE(__VA_ARGS__)
 		#endif
 		
-		#define	at90can_read_error_register(...)	can_read_error_register(__VA_ARGS__)
-		#define	at90can_set_mode(...)				can_set_mode(__VA_ARGS__)
+		#define	at90can_send_message_deadline(...)	_CAN_LOCKED(can_send_message_deadline)(__VA_ARGS__)
+		#define	at90can_send_latest_message(...)	_CAN_LOCKED(can_send_latest_message)(__VA_ARGS__)
+		#define	at90can_send_message_preemptive(...)	_CAN_LOCKED(can_send_message_preemptive)(__VA_ARGS__)
+		#define	at90can_prepare_template(...)		can_prepare_template(__VA_ARGS__)
+		#define	at90can_send_template(...)			_CAN_LOCKED(can_send_template)(__VA_ARGS__)
+		#define	at90can_read_error_register(...)	_CAN_LOCKED(can_read_error_register)(__VA_ARGS__)
+		#define	at90can_set_mode(...)				_CAN_LOCKED(can_set_mode)(__VA_ARGS__)
+		#define	at90can_set_one_shot(...)			_CAN_LOCKED(can_set_one_shot)(__VA_ARGS__)
+		#define	at90can_rx_poll_tick(...)			can_rx_poll_tick(__VA_ARGS__)
+		#define	at90can_set_periodic_message(...)	_CAN_LOCKED(can_set_periodic_message)(__VA_ARGS__)
+		#define	at90can_send_periodic_message(...)	_CAN_LOCKED(can_send_periodic_message)(__VA_ARGS__)
+		#define	at90can_set_auto_reply(...)			_CAN_LOCKED(can_set_auto_reply)(__VA_ARGS__)
+		#define	at90can_get_time(...)				can_get_time(__VA_ARGS__)
+		#define	at90can_send_timestamped_message(...)	_CAN_LOCKED(can_send_timestamped_message)(__VA_ARGS__)
+		#define	at90can_get_tx_timestamp(...)		can_get_tx_timestamp(__VA_ARGS__)
 
 	#elif (BUILD_FOR_SJA1000 == 1)
 
@@ -117,11 +286,26 @@
 		#define sja1000_check_message(...)			can_check_message(__VA_ARGS__)
 		#define sja1000_disable_filter(...)			can_disable_filter(__VA_ARGS__)
 		#define sja1000_get_message(...)			can_get_message(__VA_ARGS__)
-		#define sja1000_send_message(...)			can_send_message(__VA_ARGS__)
+		#define sja1000_send_message(...)			_CAN_SEND_MESSAGE(__VA_ARGS__)
+		#define	sja1000_prepare_template(...)		can_prepare_template(__VA_ARGS__)
+		#define	sja1000_send_template(...)			can_send_template(__VA_ARGS__)
 		#define	sja1000_read_error_register(...)	can_read_error_register(__VA_ARGS__)
 		#define	sja1000_check_bus_off(...)			can_check_bus_off(__VA_ARGS__)
 		#define	sja1000_reset_bus_off(...)			can_reset_bus_off(__VA_ARGS__)
 		#define	sja1000_set_mode(...)				can_set_mode(__VA_ARGS__)
+		#define	sja1000_set_one_shot(...)			can_set_one_shot(__VA_ARGS__)
+
+	#elif (BUILD_FOR_MCP2517FD == 1)
+
+		#define	mcp2517fd_init(...)					can_init(__VA_ARGS__)
+		#define mcp2517fd_check_free_buffer(...)	can_check_free_buffer(__VA_ARGS__)
+		#define mcp2517fd_check_message(...)		can_check_message(__VA_ARGS__)
+		#define mcp2517fd_set_filter(...)			can_set_filter(__VA_ARGS__)
+		#define mcp2517fd_disable_filter(...)		can_disable_filter(__VA_ARGS__)
+		#define mcp2517fd_get_message(...)			can_get_message(__VA_ARGS__)
+		#define mcp2517fd_send_message(...)			_CAN_SEND_MESSAGE(__VA_ARGS__)
+		#define	mcp2517fd_read_error_register(...)	can_read_error_register(__VA_ARGS__)
+		#define	mcp2517fd_set_mode(...)				can_set_mode(__VA_ARGS__)
 
 	#else
 
@@ -138,6 +322,214 @@
 	#define	CAN_INDICATE_RX_TRAFFIC_FUNCTION
 #endif
 
+#ifndef	CAN_INDICATE_TX_FAILED_FUNCTION
+	#define	CAN_INDICATE_TX_FAILED_FUNCTION
+#endif
+
+// ----------------------------------------------------------------------------
+// Priority of a message during the arbitration, lower values win.
+//
+// Bits 31..21 contain the base identifier, followed by RTR (standard frames)
+// or SRR, IDE, the 18 bit identifier extension and RTR (extended frames).
+// So a standard frame wins against an extended frame with the same base
+// identifier, exactly as on the bus.
+
+static inline uint32_t _can_arbitration_key(const can_t *msg)
+{
+	#if SUPPORT_EXTENDED_CANID
+	if (msg->flags.extended) {
+		return ((msg->id & 0x1ffc0000UL) << 3) | (3UL << 19) |
+				((msg->id & 0x3ffffUL) << 1) | (msg->flags.rtr ? 1 : 0);
+	}
+	#endif
+	
+	return ((uint32_t) msg->id << 21) | (msg->flags.rtr ? (1UL << 20) : 0);
+}
+
+// ----------------------------------------------------------------------------
+// Check if a message is accepted by a filter, using the same rules as the
+// hardware filters (see can_filter_t).
+
+static inline bool _can_filter_match(const can_filter_t *filter, const can_t *msg)
+{
+	if ((msg->id ^ filter->id) & filter->mask)
+		return false;
+	
+	if ((filter->flags.rtr & 0x02) &&
+			(filter->flags.rtr & 0x01) != (msg->flags.rtr ? 1 : 0))
+		return false;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if ((filter->flags.extended & 0x02) &&
+			(filter->flags.extended & 0x01) != (msg->flags.extended ? 1 : 0))
+		return false;
+	#endif
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// Messages built by the protocol layers are classic CAN frames. With
+// SUPPORT_CAN_FD the fd and brs flags have to be cleared explicitly.
+
+static inline void _can_classic_frame(can_t *msg)
+{
+	#if SUPPORT_CAN_FD
+	msg->flags.fd = 0;
+	msg->flags.brs = 0;
+	#else
+	(void) msg;
+	#endif
+}
+
+// ----------------------------------------------------------------------------
+// Takes a token from the class of the message, returns false if the
+// message has to be rejected.
+
+#if CAN_RATE_LIMIT_CLASSES > 0
+extern bool _can_rate_limit(const can_t *msg);
+
+// can_send_template() uses the ID and flags stored by can_prepare_template()
+extern bool _can_rate_limit_template(const can_template_t *tpl);
+
+static inline void _can_rate_limit_prepare(can_template_t *tpl, const can_t *msg)
+{
+	tpl->id = msg->id;
+	tpl->rtr = msg->flags.rtr;
+	#if SUPPORT_EXTENDED_CANID
+	tpl->extended = msg->flags.extended;
+	#endif
+}
+#endif
+
+// ----------------------------------------------------------------------------
+// Stores a received message in its mailbox, returns false if the message
+// isn't subscribed by any mailbox.
+
+#if CAN_MAILBOX_SLOTS > 0
+extern bool _can_mailbox_update(const can_t *msg);
+#endif
+
+// ----------------------------------------------------------------------------
+// Returns true if a received message has the same content as the last
+// one delivered for its change filter and should be dropped.
+
+#if CAN_CHANGE_FILTER_SLOTS > 0
+extern bool _can_suppress_unchanged(const can_t *msg);
+#endif
+
+// ----------------------------------------------------------------------------
+// FreeRTOS: puts a received message into the queue of its subscription,
+// returns false if it isn't subscribed. _can_freertos_rx_notify() wakes
+// the tasks waiting for the receive buffer. A task woken by them is
+// switched to by _can_freertos_isr_exit() at the end of the interrupt.
+
+#if CAN_FREERTOS
+#if CAN_SUBSCRIPTION_SLOTS > 0
+extern bool _can_subscription_dispatch(const can_t *msg);
+#endif
+
+extern void _can_freertos_rx_notify(void);
+
+extern void _can_freertos_isr_exit(void);
+#endif
+
+// ----------------------------------------------------------------------------
+// Software implementation of the automatic replies for controllers without
+// hardware support. Called for every received remote frame, returns true
+// if the reply was sent.
+
+#if CAN_AUTO_REPLY_SLOTS > 0 && !BUILD_FOR_AT90CAN
+extern bool _can_auto_reply(const can_t *msg);
+
+#if BUILD_FOR_MCP2515 && defined(MCP2515_INT_VECTOR)
+	// called by the interrupt => must not use the locked can_send_message()
+	#define	_CAN_AUTO_REPLY_SEND(msg)	mcp2515_send_reply(msg)
+	
+	extern bool mcp2515_send_reply(const can_t *msg);
+#else
+	#define	_CAN_AUTO_REPLY_SEND(msg)	(can_send_message(msg) != 0)
+#endif
+#endif
+
+// ----------------------------------------------------------------------------
+// Counters of discarded messages, see can_read_statistics()
+
+extern can_statistics_t _can_statistics;
+
+// ----------------------------------------------------------------------------
+// Critical sections for data shared with the CAN interrupt (buffers,
+// mailboxes, MObs, SPI bus).
+//
+// With CAN_SCOPED_CRITICAL_SECTION only the CAN interrupt is masked, all
+// other interrupts keep running. In this case the CAN functions must not
+// be called from other interrupts. can_rate_limit_tick() and
+// can_change_filter_tick() use global critical sections and may still be
+// called from a timer interrupt, can_rx_poll_tick() may not.
+
+#ifndef	CAN_SCOPED_CRITICAL_SECTION
+	#define	CAN_SCOPED_CRITICAL_SECTION		0
+#endif
+
+#if CAN_SCOPED_CRITICAL_SECTION
+	#if (BUILD_FOR_MCP2515 + BUILD_FOR_AT90CAN + BUILD_FOR_SJA1000 + BUILD_FOR_MCP2517FD) > 1
+		#error	CAN_SCOPED_CRITICAL_SECTION is only possible for one controller
+	#elif BUILD_FOR_AT90CAN
+		#define	_CAN_INT_MASK_REGISTER		CANGIE
+		#define	_CAN_INT_MASK_BIT			ENIT
+	#elif BUILD_FOR_MCP2515 && defined(MCP2515_INT_VECTOR) && defined(MCP2515_INT_MASK)
+		#define	_CAN_INT_MASK_REGISTER		_CAN_REGISTER(MCP2515_INT_MASK)
+		#define	_CAN_INT_MASK_BIT			_CAN_BIT(MCP2515_INT_MASK)
+		
+		#define	_CAN_REGISTER(x)			_CAN_REGISTER2(x)
+		#define	_CAN_REGISTER2(x,y)			x
+		#define	_CAN_BIT(x)					_CAN_BIT2(x)
+		#define	_CAN_BIT2(x,y)				y
+	#else
+		#error	CAN_SCOPED_CRITICAL_SECTION needs the AT90CAN or MCP2515_INT_VECTOR and MCP2515_INT_MASK
+	#endif
+#endif
+
+// measure the duration of the critical sections with a free running
+// 16 bit timer (e.g. TCNT1), see can_statistics_t::lock_max
+#ifdef	CAN_LOCK_TIMER
+	static inline void _can_lock_measure(uint16_t start)
+	{
+		uint16_t duration = (uint16_t) CAN_LOCK_TIMER - start;
+		
+		if (duration > _can_statistics.lock_max)
+			_can_statistics.lock_max = duration;
+	}
+	
+	#define	_CAN_LOCK_MEASURE_START		uint16_t lock_start_ = CAN_LOCK_TIMER;
+	#define	_CAN_LOCK_MEASURE_STOP		_can_lock_measure(lock_start_);
+#else
+	#define	_CAN_LOCK_MEASURE_START
+	#define	_CAN_LOCK_MEASURE_STOP
+#endif
+
+#if CAN_SCOPED_CRITICAL_SECTION
+	// the mask register itself has to be changed atomically, the CAN
+	// interrupt modifies it too (CAN_RX_POLL_THRESHOLD)
+	#define	CAN_ENTER_CRITICAL_SECTION	do { uint8_t int_mask_; \
+											ENTER_CRITICAL_SECTION; \
+											int_mask_ = _CAN_INT_MASK_REGISTER; \
+											_CAN_INT_MASK_REGISTER = int_mask_ & ~(1 << _CAN_INT_MASK_BIT); \
+											LEAVE_CRITICAL_SECTION; \
+											_CAN_LOCK_MEASURE_START
+	
+	#define	CAN_LEAVE_CRITICAL_SECTION		_CAN_LOCK_MEASURE_STOP \
+											if (int_mask_ & (1 << _CAN_INT_MASK_BIT)) { \
+												ENTER_CRITICAL_SECTION; \
+												_CAN_INT_MASK_REGISTER |= (1 << _CAN_INT_MASK_BIT); \
+												LEAVE_CRITICAL_SECTION; \
+											} \
+										} while (0)
+#else
+	#define	CAN_ENTER_CRITICAL_SECTION	ENTER_CRITICAL_SECTION; _CAN_LOCK_MEASURE_START
+	#define	CAN_LEAVE_CRITICAL_SECTION	_CAN_LOCK_MEASURE_STOP LEAVE_CRITICAL_SECTION
+#endif
+
 #ifdef	CAN_DEBUG_LEVEL
 	#include <avr/pgmspace.h>
 	#include <stdio.h>
@@ -0,0 +1,137 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_private.h"
+#include "utils.h"
+
+#if CAN_RATE_LIMIT_CLASSES > 0
+
+#if CAN_RATE_LIMIT_CLASSES > 8
+	#error	only up to 8 rate limit classes are supported!
+#endif
+
+typedef struct {
+	can_filter_t filter;
+	uint8_t rate;
+	uint8_t burst;
+	uint8_t tokens;
+} can_rate_limit_t;
+
+static can_rate_limit_t _can_rate_limit_list[CAN_RATE_LIMIT_CLASSES];
+static uint8_t _can_rate_limit_valid;
+
+// ----------------------------------------------------------------------------
+bool can_set_rate_limit(uint8_t number, const can_filter_t *filter, uint8_t rate, uint8_t burst)
+{
+	if (number >= CAN_RATE_LIMIT_CLASSES)
+		return false;
+	
+	uint8_t mask = (1 << number);
+	
+	// disable the class while it is changed
+	ENTER_CRITICAL_SECTION;
+	_can_rate_limit_valid &= ~mask;
+	LEAVE_CRITICAL_SECTION;
+	
+	if (filter != NULL)
+	{
+		can_rate_limit_t *limit = &_can_rate_limit_list[number];
+		
+		limit->filter = *filter;
+		limit->rate = rate;
+		limit->burst = burst;
+		limit->tokens = burst;
+		
+		ENTER_CRITICAL_SECTION;
+		_can_rate_limit_valid |= mask;
+		LEAVE_CRITICAL_SECTION;
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void can_rate_limit_tick(void)
+{
+	can_rate_limit_t *limit = _can_rate_limit_list;
+	
+	for (uint8_t i = 0; i < CAN_RATE_LIMIT_CLASSES; i++, limit++)
+	{
+		ENTER_CRITICAL_SECTION;
+		uint16_t tokens = limit->tokens + limit->rate;
+		limit->tokens = (tokens > limit->burst) ? limit->burst : tokens;
+		LEAVE_CRITICAL_SECTION;
+	}
+}
+
+// ----------------------------------------------------------------------------
+bool _can_rate_limit(const can_t *msg)
+{
+	bool result = true;
+	
+	ENTER_CRITICAL_SECTION;
+	can_rate_limit_t *limit = _can_rate_limit_list;
+	
+	for (uint8_t i = 0; i < CAN_RATE_LIMIT_CLASSES; i++, limit++)
+	{
+		if (!(_can_rate_limit_valid & (1 << i)) ||
+				!_can_filter_match(&limit->filter, msg))
+			continue;
+		
+		if (limit->tokens > 0) {
+			limit->tokens--;
+		}
+		else {
+			_can_statistics.tx_rate_limited++;
+			_can_statistics.rate_limited_classes |= (1 << i);
+			result = false;
+		}
+		break;
+	}
+	LEAVE_CRITICAL_SECTION;
+	
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+bool _can_rate_limit_template(const can_template_t *tpl)
+{
+	can_t msg;
+	
+	msg.id = tpl->id;
+	msg.flags.rtr = tpl->rtr;
+	#if SUPPORT_EXTENDED_CANID
+	msg.flags.extended = tpl->extended;
+	#endif
+	
+	return _can_rate_limit(&msg);
+}
+
+#endif
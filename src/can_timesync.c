@@ -0,0 +1,223 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_private.h"
+#if SUPPORT_TIMESTAMPS
+
+#include "can_timesync.h"
+
+// ----------------------------------------------------------------------------
+
+#define	TIMESYNC_SYNC			0x01
+#define	TIMESYNC_FOLLOW_UP		0x02
+
+enum {
+	STATE_IDLE,
+	STATE_SEND_SYNC,			// master: SYNC not accepted yet
+	STATE_WAIT_TIMESTAMP,		// master: SYNC not sent yet
+	STATE_SEND_FOLLOW_UP,		// master: FOLLOW_UP not accepted yet
+	STATE_SYNC_RECEIVED			// slave: waiting for the FOLLOW_UP
+};
+
+// limit of the rate correction (about 1000 ppm)
+#define	MAX_DRIFT				(1L << 14)
+
+// ----------------------------------------------------------------------------
+// The timestamps are only 16 bit, the upper part is taken from the current
+// time. Works as long as the timestamp is less than 2^16 ticks old.
+
+static uint32_t _timesync_extend(uint16_t timestamp)
+{
+	uint32_t now = CAN_TIMESYNC_TIME();
+	
+	return now - (uint16_t) ((uint16_t) now - timestamp);
+}
+
+// ----------------------------------------------------------------------------
+static void _timesync_prepare(can_timesync_t *ts, can_t *msg, uint8_t type)
+{
+	msg->id = ts->id;
+	msg->flags.rtr = 0;
+	_can_classic_frame(msg);
+	#if SUPPORT_EXTENDED_CANID
+	msg->flags.extended = 0;
+	#endif
+	msg->data[0] = type;
+	msg->data[1] = ts->sequence;
+}
+
+// ----------------------------------------------------------------------------
+// A new pair of local and master time of the same event is available.
+
+static void _timesync_update(can_timesync_t *ts, uint32_t local, uint32_t network)
+{
+	if (ts->synchronized)
+	{
+		int32_t interval = local - ts->local;
+		int32_t error = network - can_timesync_convert(ts, local);
+		
+		if (interval > 0 && error < CAN_TIMESYNC_MAX_ERROR &&
+				error > -CAN_TIMESYNC_MAX_ERROR)
+		{
+			// correct the rate by the half of the measured difference,
+			// the timestamps of single messages might be disturbed
+			ts->drift += ((int64_t) error << 23) / interval;
+			
+			if (ts->drift > MAX_DRIFT)
+				ts->drift = MAX_DRIFT;
+			else if (ts->drift < -MAX_DRIFT)
+				ts->drift = -MAX_DRIFT;
+		}
+		else {
+			// e.g. the master was restarted => start again
+			ts->drift = 0;
+		}
+	}
+	
+	// the offset is taken over directly
+	ts->local = local;
+	ts->network = network;
+	ts->synchronized = true;
+}
+
+// ----------------------------------------------------------------------------
+void can_timesync_init(can_timesync_t *ts, uint16_t id, bool master)
+{
+	ts->id = id;
+	ts->master = master;
+	ts->synchronized = master;
+	ts->state = STATE_IDLE;
+	ts->sequence = 0;
+	ts->local = 0;
+	ts->network = 0;
+	ts->drift = 0;
+}
+
+// ----------------------------------------------------------------------------
+bool can_timesync_send(can_timesync_t *ts)
+{
+	// a SYNC which wasn't sent (e.g. one-shot mode) is given up
+	bool finished = (ts->state == STATE_IDLE);
+	
+	ts->sequence++;
+	ts->state = STATE_SEND_SYNC;
+	can_timesync_process(ts);
+	
+	return finished;
+}
+
+// ----------------------------------------------------------------------------
+void can_timesync_process(can_timesync_t *ts)
+{
+	can_t msg;
+	uint16_t timestamp;
+	
+	if (ts->state == STATE_SEND_SYNC)
+	{
+		_timesync_prepare(ts, &msg, TIMESYNC_SYNC);
+		msg.length = 2;
+		
+		if (can_send_timestamped_message(&msg))
+			ts->state = STATE_WAIT_TIMESTAMP;
+	}
+	
+	if (ts->state == STATE_WAIT_TIMESTAMP && can_get_tx_timestamp(&timestamp))
+	{
+		ts->sync_time = _timesync_extend(timestamp);
+		ts->state = STATE_SEND_FOLLOW_UP;
+	}
+	
+	if (ts->state == STATE_SEND_FOLLOW_UP)
+	{
+		_timesync_prepare(ts, &msg, TIMESYNC_FOLLOW_UP);
+		msg.length = 6;
+		msg.data[2] = ts->sync_time;
+		msg.data[3] = ts->sync_time >> 8;
+		msg.data[4] = ts->sync_time >> 16;
+		msg.data[5] = ts->sync_time >> 24;
+		
+		if (can_send_message(&msg))
+			ts->state = STATE_IDLE;
+	}
+}
+
+// ----------------------------------------------------------------------------
+bool can_timesync_handle_message(can_timesync_t *ts, const can_t *msg)
+{
+	if (msg->id != ts->id || msg->flags.rtr)
+		return false;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if (msg->flags.extended)
+		return false;
+	#endif
+	
+	if (ts->master || msg->length < 2)
+		return true;
+	
+	if (msg->data[0] == TIMESYNC_SYNC)
+	{
+		ts->sync_time = _timesync_extend(msg->timestamp);
+		ts->sequence = msg->data[1];
+		ts->state = STATE_SYNC_RECEIVED;
+	}
+	else if (msg->data[0] == TIMESYNC_FOLLOW_UP && msg->length >= 6 &&
+			ts->state == STATE_SYNC_RECEIVED && msg->data[1] == ts->sequence)
+	{
+		uint32_t network = msg->data[2] |
+				((uint32_t) msg->data[3] << 8) |
+				((uint32_t) msg->data[4] << 16) |
+				((uint32_t) msg->data[5] << 24);
+		
+		_timesync_update(ts, ts->sync_time, network);
+		ts->state = STATE_IDLE;
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+uint32_t can_timesync_convert(const can_timesync_t *ts, uint32_t local)
+{
+	if (ts->master)
+		return local;
+	
+	int32_t delta = local - ts->local;
+	
+	return ts->network + delta + (int32_t) (((int64_t) delta * ts->drift) >> 24);
+}
+
+// ----------------------------------------------------------------------------
+uint32_t can_timesync_time(const can_timesync_t *ts)
+{
+	return can_timesync_convert(ts, CAN_TIMESYNC_TIME());
+}
+
+#endif	// SUPPORT_TIMESTAMPS
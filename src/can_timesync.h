@@ -0,0 +1,215 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+/**
+ * \file	can_timesync.h
+ * \brief	Synchronisation of the clocks of several nodes
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	CAN_TIMESYNC_H
+#define	CAN_TIMESYNC_H
+
+#if defined (__cplusplus)
+	extern "C" {
+#endif
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup		communication
+ * \defgroup	can_timesync Time synchronisation
+ * \brief		Common time base of all nodes (two-step, like gPTP)
+ *
+ * The master sends a SYNC message with can_send_timestamped_message() and
+ * afterwards a FOLLOW_UP message with the time at which the SYNC was
+ * sent. The slaves take the timestamp of the received SYNC and get pairs
+ * of master time and local time of the same event (the end of the SYNC
+ * frame), without the latencies of the software.
+ *
+ * Every pair sets the offset to the master, the difference to the time
+ * predicted by the previous pair corrects the rate of the local clock.
+ * Between two SYNCs the time is extrapolated with this rate.
+ *
+ * Frames (standard ID \a id, same for master and slaves):
+ * - SYNC:      [0x01, sequence]
+ * - FOLLOW_UP: [0x02, sequence, master time (32 bit, little endian)]
+ *
+ * All times are in ticks of the timestamp timer, so all nodes need the
+ * same tick rate (e.g. AT90CAN_TIMER_PRESCALER = 1 for 1 us at 16 MHz).
+ * Use a high priority identifier, otherwise other messages delay the
+ * FOLLOW_UP.
+ *
+ * \code
+ * // master, e.g. every 100 ms
+ * can_timesync_send(&sync);
+ * ...
+ * can_timesync_process(&sync);
+ *
+ * // slave
+ * if (can_get_message(&msg))
+ *     can_timesync_handle_message(&sync, &msg);
+ * ...
+ * if (sync.synchronized)
+ *     now = can_timesync_time(&sync);
+ * \endcode
+ *
+ * The AT90CAN uses can_get_time() as local time. The MCP2515 has no timer
+ * of its own, CAN_TIMESYNC_TIME() has to return a 32 bit time whose lower
+ * 16 bit are MCP2515_TIMESTAMP, e.g. TCNT1 extended by counting its
+ * overflows (in canconf.h):
+ *
+ * \code
+ * extern uint32_t timer1_get_time(void);
+ * #define CAN_TIMESYNC_TIME()  timer1_get_time()
+ * \endcode
+ *
+ * \warning	Needs SUPPORT_TIMESTAMPS and can_send_timestamped_message(),
+ *			i.e. the AT90CAN or the MCP2515 with MCP2515_INT_VECTOR.
+ */
+// ----------------------------------------------------------------------------
+
+#include "can.h"
+
+#if !SUPPORT_TIMESTAMPS
+	#error	the time synchronisation needs SUPPORT_TIMESTAMPS
+#endif
+
+/**
+ * \ingroup	can_timesync
+ * \name	Settings
+ */
+//@{
+#ifndef	CAN_TIMESYNC_TIME
+	#if !defined(SUPPORT_AT90CAN) || (SUPPORT_AT90CAN != 1)
+		#error	can_get_time() is only available for the AT90CAN, define CAN_TIMESYNC_TIME
+	#endif
+	
+	/// local time (32 bit), the lower 16 bit have to match the timestamps
+	#define	CAN_TIMESYNC_TIME()			can_get_time()
+#endif
+
+#ifndef	CAN_TIMESYNC_MAX_ERROR
+	/// larger differences restart the synchronisation (in ticks)
+	#define	CAN_TIMESYNC_MAX_ERROR		1000
+#endif
+//@}
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_timesync
+ * \brief	State of the synchronisation
+ */
+typedef struct {
+	uint16_t id;
+	bool master;
+	bool synchronized;		//!< time of the master available
+	uint8_t state;
+	uint8_t sequence;
+	
+	uint32_t sync_time;		// local time of the last SYNC
+	uint32_t local;			// local time ...
+	uint32_t network;		// ... and the corresponding master time
+	int32_t drift;			// rate correction (1 / 2^24)
+} can_timesync_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_timesync
+ * \brief	Initialise the synchronisation
+ *
+ * \param	ts		State
+ * \param	id		Identifier of the SYNC and FOLLOW_UP messages
+ * \param	master	true for the node which provides the time
+ */
+extern void
+can_timesync_init(can_timesync_t *ts, uint16_t id, bool master);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_timesync
+ * \brief	Send a SYNC message (master only)
+ *
+ * Has to be called periodically, e.g. every 100 ms. The FOLLOW_UP is
+ * sent by can_timesync_process().
+ *
+ * \return	false if the previous SYNC isn't finished yet
+ */
+extern bool
+can_timesync_send(can_timesync_t *ts);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_timesync
+ * \brief	Pass a received message to the synchronisation
+ *
+ * Has to be called within 2^16 ticks after the reception of the message,
+ * as the timestamp is extended to 32 bit with the current time.
+ *
+ * \return	true if the message belongs to the synchronisation
+ */
+extern bool
+can_timesync_handle_message(can_timesync_t *ts, const can_t *msg);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_timesync
+ * \brief	Send pending messages of the master
+ *
+ * Should be called as often as possible, the FOLLOW_UP is sent as soon as
+ * the time of the SYNC is known.
+ */
+extern void
+can_timesync_process(can_timesync_t *ts);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_timesync
+ * \brief	Convert a local time into the time of the master
+ *
+ * Can be used for timestamps of events, e.g. received messages
+ * or measurements.
+ */
+extern uint32_t
+can_timesync_convert(const can_timesync_t *ts, uint32_t local);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_timesync
+ * \brief	Current time of the master
+ *
+ * Only valid if \a synchronized is set.
+ */
+extern uint32_t
+can_timesync_time(const can_timesync_t *ts);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif	// CAN_TIMESYNC_H
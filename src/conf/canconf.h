@@ -18,12 +18,18 @@
 #define	SUPPORT_EXTENDED_CANID	1
 
 /* Select if you want to use timestamps.
- * Timestamps are sourced from a register internal to the AT90CAN.
- * Selecting them on any other controller will have no effect, they will
- * be 0 all the time.
+ * Timestamps are sourced from a register internal to the AT90CAN. The
+ * MCP2515 needs MCP2515_INT_VECTOR and MCP2515_TIMESTAMP. Selecting them on
+ * the SJA1000 will have no effect, they will be 0 all the time.
  */
 #define	SUPPORT_TIMESTAMPS		0
 
+/* Select if you want to use CAN FD (only MCP2517FD/MCP2518FD).
+ * The data field of can_t grows to 64 bytes and the flags get the fd
+ * and brs bits.
+ */
+#define	SUPPORT_CAN_FD			0
+
 
 // -----------------------------------------------------------------------------
 /* Global settings for building the can-lib.
@@ -33,6 +39,19 @@
 #define	SUPPORT_MCP2515			1
 #define	SUPPORT_AT90CAN			0
 #define	SUPPORT_SJA1000			0
+#define	SUPPORT_MCP2517FD		0
+
+/* Pins of the SPI interface for AVRs unknown to spi.h.
+ */
+// #define	P_MOSI					B,5
+// #define	P_MISO					B,6
+// #define	P_SCK					B,7
+
+/* Other targets and tests on the host: header providing the access to the
+ * pins and the SPI interface (HAL_CS_LOW() etc., see hal.h). The pins
+ * below are passed to it unchanged.
+ */
+// #define	CAN_HAL_HEADER			"board_hal.h"
 
 
 // -----------------------------------------------------------------------------
@@ -45,6 +64,48 @@
 #define	MCP2515_CS				B,4
 #define	MCP2515_INT				B,2
 
+// Let the library handle the interrupt of the MCP2515 (e.g. INT2_vect).
+// All received messages are stored in a buffer of CAN_RX_BUFFER_SIZE
+// messages. The external interrupt has to be enabled by the application
+// and must be triggered by a low level.
+// #define	MCP2515_INT_VECTOR		INT2_vect
+
+// Register and bit enabling this interrupt, needed for
+// CAN_SCOPED_CRITICAL_SECTION.
+// #define	MCP2515_INT_MASK		GICR,INT2
+
+// Source of the timestamps with SUPPORT_TIMESTAMPS, read at the beginning
+// of the interrupt. Use an input capture triggered by the INT pin (ICR1)
+// to exclude the latency of the interrupt.
+// #define	MCP2515_TIMESTAMP		TCNT1
+
+// Linux: use the MCP2515 through /dev/spidevX.Y instead of the SPI of an
+// AVR. MCP2515_CS isn't needed, the INT pin is read through a GPIO line
+// (optional). Add src/linux to the include path of the compiler.
+// #define	SPI_SPIDEV				"/dev/spidev0.0"
+// #define	SPI_SPIDEV_SPEED		10000000
+// #define	MCP2515_INT_GPIO		25
+// #define	MCP2515_INT_GPIOCHIP	"/dev/gpiochip0"
+
+// -----------------------------------------------------------------------------
+/* Setting for MCP2517FD (or MCP2518FD)
+ *
+ * Uses the same SPI pins as the MCP2515. The INT pin is optional, it is
+ * active as long as there are received messages.
+ */
+#define	MCP2517FD_CS			B,4
+#define	MCP2517FD_INT			B,2
+
+// Frequency of the oscillator in MHz (20 or 40) and bit rate of the data
+// phase of CAN FD messages in kbps (1000, 2000, 4000, 5000 or 8000).
+#define	MCP2517FD_CLOCK			40
+#define	MCP2517FD_DATA_BITRATE	2000
+
+// Number of messages in the transmit and the receive FIFO (1..32), all
+// of them have to fit into the 2 KB message RAM.
+#define	MCP2517FD_TX_FIFO_SIZE	8
+#define	MCP2517FD_RX_FIFO_SIZE	16
+
 // -----------------------------------------------------------------------------
 // Setting for SJA1000
 
@@ -67,6 +128,10 @@
 // -----------------------------------------------------------------------------
 // Setting for AT90CAN
 
+// Prescaler of the CAN timer used for the timestamps:
+// F_CPU / 8 / (AT90CAN_TIMER_PRESCALER + 1), 199 => 10 kHz, 1 => 1 MHz
+#define	AT90CAN_TIMER_PRESCALER	199
+
 // Number of CAN messages which are buffered in RAM additinally to the MObs
 #define CAN_RX_BUFFER_SIZE		16
 #define CAN_TX_BUFFER_SIZE		8
@@ -74,4 +139,91 @@
 // only available if CAN_TX_BUFFER_SIZE > 0
 #define CAN_FORCE_TX_ORDER		1
 
+// Send buffered messages ordered by their priority (CAN ID) instead of
+// first-in-first-out. Messages with the same ID keep their order.
+// only available if CAN_TX_BUFFER_SIZE > 0
+#define	CAN_TX_PRIORITY_QUEUE	0
+
+// Overload protection for the buffers: When CAN_SHED_HIGH_WATERMARK messages
+// are stored in a buffer, only messages with a base identifier (11 bit) lower
+// than CAN_SHED_PRIORITY_ID are accepted until the buffer is drained to
+// CAN_SHED_LOW_WATERMARK. Rejected messages are counted in can_statistics_t.
+// 0 disables this function.
+#define	CAN_SHED_HIGH_WATERMARK	0
+#define	CAN_SHED_LOW_WATERMARK	0
+#define	CAN_SHED_PRIORITY_ID	0x100
+
+// Discard buffered messages which have waited longer than the time given to
+// can_send_message_deadline(). Needs SUPPORT_TIMESTAMPS (the deadline is
+// stored in the timestamp field of the buffered message).
+#define	CAN_TX_DEADLINE			0
+
+// Above this number of received messages per call of can_rx_poll_tick() the
+// receive interrupt is disabled and the MObs are emptied by can_rx_poll_tick()
+// instead, until the load drops below the half of it.
+// 0 disables this function, needs CAN_RX_BUFFER_SIZE > 0.
+#define	CAN_RX_POLL_THRESHOLD	0
+
+// Number of MObs reserved for periodic messages, see can_set_periodic_message().
+// They are taken from the upper end (MOb 14 downwards) and are not available
+// as filters anymore.
+#define	CAN_PERIODIC_MOBS		0
+
+// -----------------------------------------------------------------------------
+// Number of automatic replies to remote frames, see can_set_auto_reply().
+// The AT90CAN uses one MOb per reply (below the MObs for periodic messages),
+// the MCP2515 with MCP2515_INT_VECTOR answers from the interrupt and reserves
+// TXB2 for it, the other controllers answer in software from can_get_message().
+#define	CAN_AUTO_REPLY_SLOTS	0
+
+// -----------------------------------------------------------------------------
+// Number of mailboxes which hold only the latest message of the subscribed
+// identifiers, see can_set_mailbox().
+#define	CAN_MAILBOX_SLOTS		0
+
+// Number of filters which drop received messages whose content didn't
+// change, see can_set_change_filter().
+#define	CAN_CHANGE_FILTER_SLOTS	0
+
+// -----------------------------------------------------------------------------
+// Number of ID classes with a token bucket limiting their transmit rate,
+// see can_set_rate_limit(). Up to 8 classes are possible.
+#define	CAN_RATE_LIMIT_CLASSES	0
+
+// -----------------------------------------------------------------------------
+// J1939 transport protocol (can_j1939.h): number of concurrent sessions and
+// the size of the buffer of every receive session.
+#define	CAN_J1939_RX_SESSIONS	1
+#define	CAN_J1939_TX_SESSIONS	1
+#define	CAN_J1939_MAX_LENGTH	64
+
+// Bulk transfer (can_bulk.h): frames per block and number of blocks sent
+// without waiting for an acknowledge. The receiver needs
+// CAN_BULK_BLOCK_FRAMES * CAN_BULK_WINDOW_BLOCKS * 7 bytes of RAM.
+#define	CAN_BULK_BLOCK_FRAMES	16
+#define	CAN_BULK_WINDOW_BLOCKS	2
+
+// -----------------------------------------------------------------------------
+// FreeRTOS port (can_freertos.c): the access to the controller is protected
+// by a mutex and tasks block in can_get_message_timeout() until the receive
+// interrupt wakes them. Needs MCP2515_INT_VECTOR or the AT90CAN with
+// CAN_RX_BUFFER_SIZE > 0. The path of FreeRTOS.h and FreeRTOSConfig.h
+// has to be added to the include path.
+#define	CAN_FREERTOS			0
+
+// Number of subscriptions with an own queue of CAN_SUBSCRIPTION_QUEUE_SIZE
+// messages, see can_set_subscription().
+#define	CAN_SUBSCRIPTION_SLOTS	0
+#define	CAN_SUBSCRIPTION_QUEUE_SIZE	4
+
+// -----------------------------------------------------------------------------
+// Mask only the CAN interrupt (CANGIE.ENIT or MCP2515_INT_MASK) instead of
+// all interrupts while the library accesses data shared with its ISR.
+// The CAN functions must not be called from other interrupts then.
+#define	CAN_SCOPED_CRITICAL_SECTION	0
+
+// Free running 16 bit timer used to measure the longest critical section,
+// the result is reported in can_statistics_t::lock_max.
+// #define	CAN_LOCK_TIMER			TCNT1
+
 #endif	// CANCONFIG_H
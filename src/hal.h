@@ -0,0 +1,150 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	HAL_H
+#define	HAL_H
+
+// ----------------------------------------------------------------------------
+/**
+ * \file	hal.h
+ * \brief	Access to the pins and the SPI interface of the target
+ *
+ * The drivers of the external controllers (MCP2515, MCP2517FD and SJA1000
+ * with port interface) access the hardware only through the following
+ * macros and functions, which are all resolved at compile time:
+ *
+ * HAL_CS_INIT(pin)			chip select as output, inactive (high)
+ * HAL_CS_LOW(pin)			start of a SPI transaction
+ * HAL_CS_HIGH(pin)			end of a SPI transaction
+ * HAL_INPUT_INIT(pin)		input with pull-up (INT and RXnBF pins)
+ * HAL_INPUT_IS_LOW(pin)	state of an active low input
+ *
+ * spi_init(), spi_putc(), spi_read(), spi_start(), spi_wait() (see spi.h)
+ *
+ * hal_bus_init()			data bus and strobes of the SJA1000
+ * hal_bus_address(a)		output the address and strobe ALE
+ * hal_bus_write(d)			write to the data bus with a WR strobe
+ * hal_bus_read()			read from the data bus with a RD strobe
+ *
+ * On the AVR they map directly to the port registers and SPDR, so there
+ * is no overhead compared to using them directly. SPI_SPIDEV selects the
+ * implementation for Linux. For other targets and tests on the host
+ * CAN_HAL_HEADER names a header which provides all of them, the pins
+ * (MCP2515_CS etc.) are given in the form this header expects.
+ * Replacements for the avr-libc headers are found in src/linux.
+ */
+// ----------------------------------------------------------------------------
+
+#include "can_private.h"
+
+#if defined(CAN_HAL_HEADER)
+	#if defined(SPI_SPIDEV)
+		#error	SPI_SPIDEV and CAN_HAL_HEADER are mutually exclusive
+	#endif
+	
+	#include CAN_HAL_HEADER
+
+#elif defined(SPI_SPIDEV)
+	// the chip select is handled by the spidev driver
+	#define	HAL_CS_INIT(pin)
+	#define	HAL_CS_LOW(pin)			spi_select()
+	#define	HAL_CS_HIGH(pin)		spi_deselect()
+
+#elif defined(__AVR__)
+	#include "utils.h"
+	
+	// the pins are given as "port,bit" which has to be split by a second
+	// macro, see SET() in utils.h
+	#define	HAL_CS_INIT(pin)		do { SET2(pin); SET_OUTPUT2(pin); } while (0)
+	#define	HAL_CS_LOW(pin)			RESET2(pin)
+	#define	HAL_CS_HIGH(pin)		SET2(pin)
+	
+	#define	HAL_INPUT_INIT(pin)		do { SET_INPUT2(pin); SET2(pin); } while (0)
+	#define	HAL_INPUT_IS_LOW(pin)	(!IS_SET2(pin))
+	
+	#if BUILD_FOR_SJA1000 && defined(SJA1000_DATA)
+	
+	#define	HAL_NOP()				__asm__ __volatile__ ("nop")
+	
+	static inline void hal_bus_init(void)
+	{
+		SET(SJA1000_WR);
+		SET(SJA1000_RD);
+		RESET(SJA1000_ALE);
+		RESET(SJA1000_CS);
+		
+		SET_OUTPUT(SJA1000_WR);
+		SET_OUTPUT(SJA1000_RD);
+		SET_OUTPUT(SJA1000_ALE);
+		
+		SET_OUTPUT(SJA1000_CS);
+		DDR_(SJA1000_DATA) = 0xff;
+	}
+	
+	static inline void hal_bus_address(uint8_t address)
+	{
+		SET(SJA1000_ALE);
+		PORT_(SJA1000_DATA) = address;
+		HAL_NOP();
+		RESET(SJA1000_ALE);
+	}
+	
+	static inline void hal_bus_write(uint8_t data)
+	{
+		PORT_(SJA1000_DATA) = data;
+		RESET(SJA1000_WR);
+		HAL_NOP();
+		SET(SJA1000_WR);
+	}
+	
+	static inline uint8_t hal_bus_read(void)
+	{
+		uint8_t data;
+		
+		DDR_(SJA1000_DATA) = 0;
+		RESET(SJA1000_RD);
+		HAL_NOP();
+		data = PIN_(SJA1000_DATA);
+		SET(SJA1000_RD);
+		DDR_(SJA1000_DATA) = 0xff;
+		
+		return data;
+	}
+	
+	#endif
+#else
+	#error	no hardware abstraction for this target, define CAN_HAL_HEADER!
+#endif
+
+#if BUILD_FOR_MCP2515 || BUILD_FOR_MCP2517FD
+	#include "spi.h"
+#endif
+
+#endif	// HAL_H
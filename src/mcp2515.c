@@ -69,13 +69,13 @@
 // -------------------------------------------------------------------------
 void mcp2515_write_register( uint8_t adress, uint8_t data )
 {
-	RESET(MCP2515_CS);
+	MCP2515_SELECT;
 	
 	spi_putc(SPI_WRITE);
 	spi_putc(adress);
 	spi_putc(data);
 	
-	SET(MCP2515_CS);
+	MCP2515_DESELECT;
 }
 
 // -------------------------------------------------------------------------
@@ -83,14 +83,14 @@ uint8_t mcp2515_read_register(uint8_t adress)
 {
 	uint8_t data;
 	
-	RESET(MCP2515_CS);
+	MCP2515_SELECT;
 	
 	spi_putc(SPI_READ);
 	spi_putc(adress);
 	
-	data = spi_putc(0xff);	
+	spi_read(&data, 1);
 	
-	SET(MCP2515_CS);
+	MCP2515_DESELECT;
 	
 	return data;
 }
@@ -98,14 +98,14 @@ uint8_t mcp2515_read_register(uint8_t adress)
 // -------------------------------------------------------------------------
 void mcp2515_bit_modify(uint8_t adress, uint8_t mask, uint8_t data)
 {
-	RESET(MCP2515_CS);
+	MCP2515_SELECT;
 	
 	spi_putc(SPI_BIT_MODIFY);
 	spi_putc(adress);
 	spi_putc(mask);
 	spi_putc(data);
 	
-	SET(MCP2515_CS);
+	MCP2515_DESELECT;
 }
 
 // ----------------------------------------------------------------------------
@@ -113,12 +113,12 @@ uint8_t mcp2515_read_status(uint8_t type)
 {
 	uint8_t data;
 	
-	RESET(MCP2515_CS);
+	MCP2515_SELECT;
 	
 	spi_putc(type);
-	data = spi_putc(0xff);
+	spi_read(&data, 1);
 	
-	SET(MCP2515_CS);
+	MCP2515_DESELECT;
 	
 	return data;
 }
@@ -221,35 +221,30 @@ bool mcp2515_init(can_bitrate_t bitrate)
 	if (bitrate >= 8)
 		return false;
 	
-	SET(MCP2515_CS);
-	SET_OUTPUT(MCP2515_CS);
-	
-	// Aktivieren der Pins fuer das SPI Interface
-	RESET(P_SCK);
-	RESET(P_MOSI);
-	RESET(P_MISO);
-	
-	SET_OUTPUT(P_SCK);
-	SET_OUTPUT(P_MOSI);
-	SET_INPUT(P_MISO);
+	HAL_CS_INIT(MCP2515_CS);
 	
 	// SPI Einstellung setzen
-	mcp2515_spi_init();
+	if (!spi_init())
+		return false;
 	
 	// MCP2515 per Software Reset zuruecksetzten,
 	// danach ist er automatisch im Konfigurations Modus
-	RESET(MCP2515_CS);
+	MCP2515_CS_LOW;
 	spi_putc(SPI_RESET);
 	
 	_delay_ms(1);
 	
-	SET(MCP2515_CS);
+	MCP2515_CS_HIGH;
 	
 	// ein bisschen warten bis der MCP2515 sich neu gestartet hat
 	_delay_ms(10);
 	
+	#ifdef	MCP2515_INT_VECTOR
+	can_buffer_init( &can_rx_buffer, CAN_RX_BUFFER_SIZE, can_rx_list );
+	#endif
+	
 	// CNF1..3 Register laden (Bittiming)
-	RESET(MCP2515_CS);
+	MCP2515_CS_LOW;
 	spi_putc(SPI_WRITE);
 	spi_putc(CNF3);
 	for (uint8_t i=0; i<3 ;i++ ) {
@@ -257,22 +252,21 @@ bool mcp2515_init(can_bitrate_t bitrate)
 	}
 	// aktivieren/deaktivieren der Interrupts
 	spi_putc(MCP2515_INTERRUPTS);
-	SET(MCP2515_CS);
+	MCP2515_CS_HIGH;
 	
 	// TXnRTS Bits als Inputs schalten
 	mcp2515_write_register(TXRTSCTRL, 0);
 	
 	#if defined(MCP2515_INT)
-		SET_INPUT(MCP2515_INT);
-		SET(MCP2515_INT);
+		HAL_INPUT_INIT(MCP2515_INT);
+	#elif defined(SPI_SPIDEV) && defined(MCP2515_INT_GPIO)
+		if (!mcp2515_int_init())
+			return false;
 	#endif
 	
 	#ifdef RXnBF_FUNKTION
-		SET_INPUT(MCP2515_RX0BF);
-		SET_INPUT(MCP2515_RX1BF);
-		
-		SET(MCP2515_RX0BF);
-		SET(MCP2515_RX1BF);
+		HAL_INPUT_INIT(MCP2515_RX0BF);
+		HAL_INPUT_INIT(MCP2515_RX1BF);
 		
 		// Aktivieren der Pin-Funktionen fuer RX0BF und RX1BF
 		mcp2515_write_register(BFPCTRL, (1<<B0BFE)|(1<<B1BFE)|(1<<B0BFM)|(1<<B1BFM));
@@ -36,11 +36,15 @@
 
 bool mcp2515_check_message(void)
 {
-	#if defined(MCP2515_INT)
-		return ((!IS_SET(MCP2515_INT)) ? true : false);
+	#if defined(MCP2515_INT_VECTOR)
+		return !can_buffer_empty( &can_rx_buffer );
+	#elif defined(MCP2515_INT)
+		return HAL_INPUT_IS_LOW(MCP2515_INT);
+	#elif defined(SPI_SPIDEV) && defined(MCP2515_INT_GPIO)
+		return mcp2515_int_active();
 	#else
 		#ifdef RXnBF_FUNKTION
-			if (!IS_SET(MCP2515_RX0BF) || !IS_SET(MCP2515_RX1BF))
+			if (HAL_INPUT_IS_LOW(MCP2515_RX0BF) || HAL_INPUT_IS_LOW(MCP2515_RX1BF))
 				return true;
 			else
 				return false;
@@ -57,7 +61,14 @@ bool mcp2515_check_free_buffer(void)
 {
 	uint8_t status = mcp2515_read_status(SPI_READ_STATUS);
 	
+	if (_mcp2515_one_shot_pending)
+		mcp2515_check_one_shot(status);
+	
+	#if MCP2515_TX_BUFFERS > 2
 	if ((status & 0x54) == 0x54)
+	#else
+	if ((status & 0x14) == 0x14)
+	#endif
 		return false;		// all buffers used
 	else
 		return true;
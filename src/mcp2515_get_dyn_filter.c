@@ -81,12 +81,16 @@ uint8_t mcp2515_get_filter(uint8_t number, can_filter_t *filter)
 	filter->flags.extended = temp;
 	#endif
 	
+	uint8_t reg[4];
+	
 	// read mask
-	RESET(MCP2515_CS);
+	MCP2515_SELECT;
 	spi_putc(SPI_READ);
 	spi_putc(mask_address);
-	mcp2515_read_id(&filter->mask);
-	SET(MCP2515_CS);
+	spi_read(reg, 4);
+	MCP2515_DESELECT;
+	
+	mcp2515_read_id(reg, &filter->mask);
 	
 	if (number <= 2)
 	{
@@ -98,11 +102,13 @@ uint8_t mcp2515_get_filter(uint8_t number, can_filter_t *filter)
 	}
 	
 	// read filter
-	RESET(MCP2515_CS);
+	MCP2515_SELECT;
 	spi_putc(SPI_READ);
 	spi_putc(filter_address);
-	mcp2515_read_id(&filter->id);
-	SET(MCP2515_CS);
+	spi_read(reg, 4);
+	MCP2515_DESELECT;
+	
+	mcp2515_read_id(reg, &filter->id);
 	
 	// restore previous mode
 	mcp2515_change_operation_mode( mode );
@@ -29,7 +29,7 @@
 // ----------------------------------------------------------------------------
 
 #include "mcp2515_private.h"
-#ifdef	SUPPORT_FOR_MCP2515__
+#if defined(SUPPORT_FOR_MCP2515__) && !defined(MCP2515_INT_VECTOR)
 
 // ----------------------------------------------------------------------------
 
@@ -38,9 +38,9 @@ uint8_t mcp2515_get_message(can_t *msg)
 	uint8_t addr;
 	
 	#ifdef	RXnBF_FUNKTION
-		if (!IS_SET(MCP2515_RX0BF))
+		if (HAL_INPUT_IS_LOW(MCP2515_RX0BF))
 			addr = SPI_READ_RX;
-		else if (!IS_SET(MCP2515_RX1BF))
+		else if (HAL_INPUT_IS_LOW(MCP2515_RX1BF))
 			addr = SPI_READ_RX | 0x04;
 		else
 			return 0;
@@ -62,32 +62,39 @@ uint8_t mcp2515_get_message(can_t *msg)
 		}
 	#endif
 	
-	RESET(MCP2515_CS);
+	MCP2515_CS_LOW;
 	spi_putc(addr);
 	
+	// SIDH, SIDL, EID8, EID0, DLC
+	uint8_t header[5];
+	spi_read(header, 5);
+	
+	#if SPI_DEFERRED_READ
+		// the length is only known after the transfer,
+		// so the whole buffer is read at once
+		spi_read(msg->data, 8);
+		MCP2515_CS_HIGH;
+	#endif
+	
+	// The interrupt flag of the buffer is cleared by the MCP2515 at the
+	// end of the SPI_READ_RX command.
+	
 	// CAN ID auslesen und ueberpruefen
-	uint8_t tmp = mcp2515_read_id(&msg->id);
+	uint8_t tmp = mcp2515_read_id(header, &msg->id);
 	#if SUPPORT_EXTENDED_CANID
 		msg->flags.extended = tmp & 0x01;
 	#else
 		if (tmp & 0x01) {
 			// Nachrichten mit extended ID verwerfen
-			SET(MCP2515_CS);
-			#ifdef	RXnBF_FUNKTION
-			if (!IS_SET(MCP2515_RX0BF))
-			#else
-			if (_bit_is_set(status, 6))
+			#if !SPI_DEFERRED_READ
+			MCP2515_CS_HIGH;
 			#endif
-				mcp2515_bit_modify(CANINTF, (1<<RX0IF), 0);
-			else
-				mcp2515_bit_modify(CANINTF, (1<<RX1IF), 0);
-			
 			return 0;
 		}
 	#endif
 	
 	// read DLC
-	uint8_t length = spi_putc(0xff);
+	uint8_t length = header[4];
 	#ifdef RXnBF_FUNKTION
 		if (!(tmp & 0x01))
 			msg->flags.rtr = (tmp & 0x02) ? 1 : 0;
@@ -98,25 +105,39 @@ uint8_t mcp2515_get_message(can_t *msg)
 	#endif
 	
 	length &= 0x0f;
+	if (length > 8)
+		length = 8;
 	msg->length = length;
-	// read data
-	for (uint8_t i=0;i<length;i++) {
-		msg->data[i] = spi_putc(0xff);
-	}
-	SET(MCP2515_CS);
 	
-	// clear interrupt flag
-	#ifdef RXnBF_FUNKTION
-	if (!IS_SET(MCP2515_RX0BF))
-	#else
-	if (_bit_is_set(status, 6))
+	#if !SPI_DEFERRED_READ
+		// read data
+		spi_read(msg->data, length);
+		MCP2515_CS_HIGH;
 	#endif
-		mcp2515_bit_modify(CANINTF, (1<<RX0IF), 0);
-	else
-		mcp2515_bit_modify(CANINTF, (1<<RX1IF), 0);
 	
 	CAN_INDICATE_RX_TRAFFIC_FUNCTION;
 	
+	#if CAN_AUTO_REPLY_SLOTS > 0
+	if (msg->flags.rtr && _can_auto_reply(msg)) {
+		// remote frame was already answered
+		return 0;
+	}
+	#endif
+	
+	#if CAN_MAILBOX_SLOTS > 0
+	if (_can_mailbox_update(msg)) {
+		// message was stored in a mailbox
+		return 0;
+	}
+	#endif
+	
+	#if CAN_CHANGE_FILTER_SLOTS > 0
+	if (_can_suppress_unchanged(msg)) {
+		// content didn't change since the last message
+		return 0;
+	}
+	#endif
+	
 	#ifdef RXnBF_FUNKTION
 		return 1;
 	#else
@@ -0,0 +1,219 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2515_private.h"
+#if defined(SUPPORT_FOR_MCP2515__) && defined(MCP2515_INT_VECTOR)
+
+// ----------------------------------------------------------------------------
+
+can_buffer_t can_rx_buffer;
+can_t can_rx_list[CAN_RX_BUFFER_SIZE];
+
+#if SUPPORT_TIMESTAMPS
+volatile uint8_t _mcp2515_timestamp_flag;	//!< TXnIF of can_send_timestamped_message()
+volatile uint16_t _mcp2515_tx_timestamp;
+volatile bool _mcp2515_tx_timestamp_valid;
+
+static uint16_t _isr_timestamp;			//!< time of the current interrupt
+#endif
+
+#if CAN_AUTO_REPLY_SLOTS > 0
+// ----------------------------------------------------------------------------
+// TXB2 is only used for the replies, see MCP2515_TX_BUFFERS
+
+bool mcp2515_send_reply(const can_t *msg)
+{
+	if (mcp2515_read_status(SPI_READ_STATUS) & (1 << 6))
+		return false;
+	
+	mcp2515_start_transmission(0x04, msg);
+	return true;
+}
+#endif
+
+// ----------------------------------------------------------------------------
+// Read the message in RXB0 or RXB1 and push it to the receive buffer.
+
+static void _read_rx_buffer(uint8_t address)
+{
+	can_t msg;
+	
+	// RXBnCTRL (contains the RTR bit for standard frames),
+	// SIDH, SIDL, EID8, EID0 and DLC
+	uint8_t reg[6];
+	
+	MCP2515_CS_LOW;
+	spi_putc(SPI_READ);
+	spi_putc(address);
+	spi_read(reg, 6);
+	
+	uint8_t tmp = mcp2515_read_id(reg + 1, &msg.id);
+	uint8_t length = reg[5];
+	
+	#if SUPPORT_EXTENDED_CANID
+		msg.flags.extended = tmp & 0x01;
+	#else
+		if (tmp & 0x01) {
+			// Nachrichten mit extended ID verwerfen
+			MCP2515_CS_HIGH;
+			return;
+		}
+	#endif
+	
+	if (tmp & 0x01)
+		msg.flags.rtr = (length & (1<<RTR)) ? 1 : 0;
+	else
+		msg.flags.rtr = (reg[0] & (1<<RXRTR)) ? 1 : 0;
+	
+	length &= 0x0f;
+	if (length > 8)
+		length = 8;
+	msg.length = length;
+	spi_read(msg.data, length);
+	MCP2515_CS_HIGH;
+	
+	#if SUPPORT_TIMESTAMPS
+	msg.timestamp = _isr_timestamp;
+	#endif
+	
+	CAN_INDICATE_RX_TRAFFIC_FUNCTION;
+	
+	#if CAN_AUTO_REPLY_SLOTS > 0
+	if (msg.flags.rtr && _can_auto_reply(&msg))
+		return;
+	#endif
+	
+	#if CAN_MAILBOX_SLOTS > 0
+	if (_can_mailbox_update(&msg))
+		return;
+	#endif
+	
+	#if CAN_CHANGE_FILTER_SLOTS > 0
+	if (_can_suppress_unchanged(&msg))
+		return;
+	#endif
+	
+	#if CAN_SUBSCRIPTION_SLOTS > 0
+	if (_can_subscription_dispatch(&msg))
+		return;
+	#endif
+	
+	can_t *buf = can_buffer_get_enqueue_ptr(&can_rx_buffer);
+	
+	if (buf == NULL) {
+		// buffer overflow => reject message
+		_can_statistics.rx_overflow++;
+	}
+	#if CAN_SHED_HIGH_WATERMARK > 0
+	else if (!can_buffer_accept(&can_rx_buffer, &msg)) {
+		// buffer nearly full => drop low priority messages
+		_can_statistics.rx_shed++;
+	}
+	#endif
+	else {
+		// push it to the list
+		*buf = msg;
+		can_buffer_enqueue(&can_rx_buffer);
+		
+		#if CAN_FREERTOS
+		_can_freertos_rx_notify();
+		#endif
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Reads CANINTF and EFLG once, handles all pending flags and clears them
+// afterwards with a single BIT MODIFY command.
+// 
+// The external interrupt has to be configured for a low level, otherwise
+// a flag set while the ISR is running might be lost.
+
+ISR(MCP2515_INT_VECTOR)
+{
+	#if SUPPORT_TIMESTAMPS
+	// taken as early as possible, the latency of the interrupt is added
+	// to all timestamps (unless MCP2515_TIMESTAMP is an input capture)
+	_isr_timestamp = MCP2515_TIMESTAMP;
+	#endif
+	
+	uint8_t reg[2];
+	
+	MCP2515_CS_LOW;
+	spi_putc(SPI_READ);
+	spi_putc(CANINTF);
+	spi_read(reg, 2);
+	MCP2515_CS_HIGH;
+	
+	uint8_t intf = reg[0];
+	uint8_t eflg = reg[1];
+	
+	// only the flags of enabled interrupts are handled here, the others
+	// (e.g. TXnIF with one-shot mode) are still polled by the library
+	#if SUPPORT_TIMESTAMPS
+	intf &= (MCP2515_INTERRUPTS) | _mcp2515_timestamp_flag;
+	
+	if (intf & _mcp2515_timestamp_flag)
+	{
+		// the timestamped message was sent
+		_mcp2515_tx_timestamp = _isr_timestamp;
+		_mcp2515_tx_timestamp_valid = true;
+		
+		mcp2515_bit_modify(CANINTE, _mcp2515_timestamp_flag & ~(MCP2515_INTERRUPTS), 0);
+		_mcp2515_timestamp_flag = 0;
+	}
+	#else
+	intf &= MCP2515_INTERRUPTS;
+	#endif
+	
+	if (intf & (1<<RX0IF))
+		_read_rx_buffer(RXB0CTRL);
+	
+	if (intf & (1<<RX1IF))
+		_read_rx_buffer(RXB1CTRL);
+	
+	if ((intf & (1<<ERRIF)) && (eflg & ((1<<RX1OVR)|(1<<RX0OVR))))
+	{
+		// a message was lost because both receive buffers were full
+		_can_statistics.rx_overflow++;
+		
+		mcp2515_bit_modify(EFLG, (1<<RX1OVR)|(1<<RX0OVR), 0);
+	}
+	
+	// TXnIF, WAKIF and MERRF need no further work, clearing them
+	// releases the INT pin
+	if (intf)
+		mcp2515_bit_modify(CANINTF, intf, 0);
+	
+	#if CAN_FREERTOS
+	_can_freertos_isr_exit();
+	#endif
+}
+
+#endif	// SUPPORT_FOR_MCP2515__
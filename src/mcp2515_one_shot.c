@@ -0,0 +1,74 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2515_private.h"
+#ifdef	SUPPORT_FOR_MCP2515__
+
+// ----------------------------------------------------------------------------
+
+bool _mcp2515_one_shot = false;
+uint8_t _mcp2515_one_shot_pending = 0;
+
+// ----------------------------------------------------------------------------
+void mcp2515_set_one_shot(bool enable)
+{
+	_mcp2515_one_shot = enable;
+	
+	mcp2515_bit_modify(CANCTRL, (1<<OSM), (enable) ? (1<<OSM) : 0);
+}
+
+// ----------------------------------------------------------------------------
+void mcp2515_check_one_shot(uint8_t status)
+{
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		uint8_t buffer = (1 << i);
+		
+		// TXREQ is cleared after the one attempt to send the message
+		if (!(_mcp2515_one_shot_pending & buffer) ||
+				(status & (1 << (2 + 2 * i))))
+			continue;
+		
+		CAN_ENTER_CRITICAL_SECTION;
+		_mcp2515_one_shot_pending &= ~buffer;
+		CAN_LEAVE_CRITICAL_SECTION;
+		
+		uint8_t ctrl = mcp2515_read_register(TXB0CTRL + (i << 4));
+		if (ctrl & ((1<<ABTF)|(1<<MLOA)|(1<<TXERR)))
+		{
+			_can_statistics.tx_failed++;
+			mcp2515_release_timestamp(i);
+			
+			CAN_INDICATE_TX_FAILED_FUNCTION;
+		}
+	}
+}
+
+#endif	// SUPPORT_FOR_MCP2515__
@@ -0,0 +1,160 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2515_private.h"
+#ifdef	SUPPORT_FOR_MCP2515__
+
+#include <util/delay.h>
+
+uint8_t _mcp2515_urgent_buffers = 0;
+
+// ----------------------------------------------------------------------------
+void mcp2515_restore_tx_priority(uint8_t status)
+{
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		uint8_t bit = 1 << (2 + 2 * i);
+		
+		if ((_mcp2515_urgent_buffers & bit) && !(status & bit))
+		{
+			mcp2515_bit_modify(TXB0CTRL + (i << 4), (1<<TXP1)|(1<<TXP0), 0);
+			_mcp2515_urgent_buffers &= ~bit;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+void mcp2515_read_tx_buffer(uint8_t buffer, can_t *msg)
+{
+	// SIDH, SIDL, EID8, EID0, DLC and the data
+	uint8_t header[5];
+	
+	MCP2515_SELECT;
+	spi_putc(SPI_READ);
+	spi_putc(TXB0SIDH + (buffer << 4));
+	spi_read(header, 5);
+	spi_read(msg->data, 8);
+	MCP2515_DESELECT;
+	
+	uint8_t tmp = mcp2515_read_id(header, &msg->id);
+	#if SUPPORT_EXTENDED_CANID
+		msg->flags.extended = tmp & 0x01;
+	#else
+		(void) tmp;
+	#endif
+	
+	// read DLC
+	uint8_t length = header[4];
+	msg->flags.rtr = (length & (1<<RTR)) ? 1 : 0;
+	
+	length &= 0x0f;
+	if (length > 8)
+		length = 8;
+	msg->length = length;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t mcp2515_send_message_preemptive(const can_t *msg, can_t *aborted)
+{
+	uint8_t code;
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit(msg))
+		return 0;
+	#endif
+	
+	uint8_t address = mcp2515_get_free_tx_buffer();
+	if (address != 0xff)
+		return mcp2515_start_transmission(address, msg);
+	
+	// All buffers are in use => search the pending message with the
+	// lowest priority. It is only replaced if the new message would
+	// win the arbitration against it.
+	uint32_t lowest = _can_arbitration_key(msg);
+	uint8_t buffer = 0xff;
+	can_t tmp;
+	
+	for (uint8_t i = 0; i < MCP2515_TX_BUFFERS; i++)
+	{
+		mcp2515_read_tx_buffer(i, &tmp);
+		
+		uint32_t key = _can_arbitration_key(&tmp);
+		if (key > lowest) {
+			lowest = key;
+			buffer = i;
+			*aborted = tmp;
+		}
+	}
+	
+	if (buffer == 0xff)
+		return 0;
+	
+	// Request the abort. A message which is already on the bus
+	// can't be aborted, in this case wait until it was sent. This
+	// takes at most one frame (about 16 ms at 10 kbps), the
+	// transmission isn't repeated after an error once TXREQ is cleared.
+	uint8_t ctrl = TXB0CTRL + (buffer << 4);
+	uint8_t status;
+	uint16_t i = 0;
+	
+	mcp2515_bit_modify(ctrl, (1<<TXREQ), 0);
+	while ((status = mcp2515_read_register(ctrl)) & (1<<TXREQ))
+	{
+		if (++i > 1000) {
+			// the transmission doesn't end (e.g. no acknowledge)
+			// => keep the old message
+			mcp2515_bit_modify(ctrl, (1<<TXREQ), (1<<TXREQ));
+			return 0;
+		}
+		
+		_delay_us(20);
+	}
+	
+	if (status & (1<<ABTF)) {
+		// TXnIF won't be set for the aborted message
+		mcp2515_release_timestamp(buffer);
+	}
+	
+	// Send the new message with the highest priority so that it is
+	// the next message from the MCP2515 to enter the bus. TXP is reset
+	// by mcp2515_get_free_tx_buffer() after the message was sent.
+	mcp2515_bit_modify(ctrl, (1<<TXP1)|(1<<TXP0), (1<<TXP1)|(1<<TXP0));
+	_mcp2515_urgent_buffers |= 1 << (2 + 2 * buffer);
+	code = mcp2515_start_transmission(buffer << 1, msg);
+	
+	if (status & (1<<ABTF)) {
+		// the aborted message has to be send again by the caller
+		code |= CAN_PREEMPTED;
+	}
+	
+	return code;
+}
+
+#endif	// SUPPORT_FOR_MCP2515__
@@ -51,43 +51,12 @@
 #include "utils.h"
 
 #include "can_private.h"
-#include "spi.h"
+#include "hal.h"
 
 // ----------------------------------------------------------------------------
 
-#if (BUILD_FOR_MCP2515 == 1)
-	#if defined(__AVR_ATmega16__) || defined(__AVR_ATmega32__) || defined(__AVR_ATmega644__)
-		#define	P_MOSI	B,5
-		#define	P_MISO	B,6
-		#define	P_SCK	B,7
-		#define	SUPPORT_FOR_MCP2515__
-	#elif defined(__AVR_AT90USB82__) || defined(__AVR_AT90USB162__)
-		#define P_MOSI  B,2
-		#define P_MISO  B,3
-		#define P_SCK   B,1
-		#define SUPPORT_FOR_MCP2515__
-	#elif defined(__AVR_ATmega8__)  || defined(__AVR_ATmega48__) || \
-		  defined(__AVR_ATmega88__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || \
-		  defined(__AVR_ATmega48A__) || defined(__AVR_ATmega88A__) || defined(__AVR_ATmega168A__)
-		#define	P_MOSI	B,3
-		#define	P_MISO	B,4
-		#define	P_SCK	B,5
-		#define	SUPPORT_FOR_MCP2515__
-	#elif defined(__AVR_ATmega128__)
-		#define	P_MOSI	B,2
-		#define	P_MISO	B,3
-		#define	P_SCK	B,1
-		#define	SUPPORT_FOR_MCP2515__
-	#elif defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
-		#define	P_MOSI	B,0
-		#define	P_MISO	B,1
-		#define	P_SCK	B,2
-		
-		#define	USE_SOFTWARE_SPI		1
-		#define	SUPPORT_FOR_MCP2515__
-	#else
-		#error	choosen AVR-type is not supported yet!
-	#endif
+#if (BUILD_FOR_MCP2515 == 1) && defined(SUPPORT_FOR_SPI__)
+	#define	SUPPORT_FOR_MCP2515__
 #endif
 
 
@@ -99,6 +68,36 @@
 #ifndef	MCP2515_CLKOUT_PRESCALER
 	#define	MCP2515_CLKOUT_PRESCALER	0
 #endif
+
+#ifdef	MCP2515_INT_VECTOR
+	// the library handles the interrupt => all received messages are
+	// stored in can_rx_buffer
+	#if CAN_RX_BUFFER_SIZE == 0
+		#error	MCP2515_INT_VECTOR needs CAN_RX_BUFFER_SIZE > 0
+	#endif
+	
+	#ifndef	MCP2515_INTERRUPTS
+		#define	MCP2515_INTERRUPTS		(1<<MERRE)|(1<<ERRIE)|(1<<RX1IE)|(1<<RX0IE)
+	#endif
+	
+	// the MCP2515 has no timer, the timestamps are taken from an AVR timer
+	// at the beginning of the interrupt
+	#if SUPPORT_TIMESTAMPS && !defined(MCP2515_TIMESTAMP)
+		#error	SUPPORT_TIMESTAMPS needs MCP2515_TIMESTAMP (e.g. TCNT1 or ICR1)
+	#endif
+	
+	// the automatic replies are sent by the interrupt, TXB2 is reserved
+	// for them so that they never collide with a message which is just
+	// loaded by the application
+	#if CAN_AUTO_REPLY_SLOTS > 0
+		#define	MCP2515_TX_BUFFERS		2
+	#endif
+#endif
+
+#ifndef	MCP2515_TX_BUFFERS
+	#define	MCP2515_TX_BUFFERS			3
+#endif
+
 #ifndef	MCP2515_INTERRUPTS
 	#define	MCP2515_INTERRUPTS			(1<<RX1IE)|(1<<RX0IE)
 #endif
@@ -107,7 +106,17 @@
 // TODO: this file is imcompatible with the at90can
 #include "mcp2515_defs.h"
 
-#ifndef	MCP2515_CS
+#if defined(SPI_SPIDEV)
+	// the chip select is handled by the spidev driver, the INT pin
+	// can be used through a GPIO (MCP2515_INT_GPIO)
+	#if defined(MCP2515_INT) || defined(MCP2515_INT_VECTOR) || defined(MCP2515_RX0BF) || defined(MCP2515_RX1BF)
+		#error	MCP2515_INT, MCP2515_INT_VECTOR and MCP2515_RXnBF are not available with SPI_SPIDEV
+	#endif
+	
+	#if defined(MCP2515_INT_GPIO) && !defined(MCP2515_INT_GPIOCHIP)
+		#define	MCP2515_INT_GPIOCHIP		"/dev/gpiochip0"
+	#endif
+#elif !defined(MCP2515_CS)
 	#error	MCP2515_CS ist nicht definiert!
 #endif
 
@@ -119,6 +128,52 @@
 	#define	RXnBF_FUNKTION
 #endif
 
+// -------------------------------------------------------------------------
+/**
+ * \brief	Start and end a SPI transaction
+ *
+ * If the library handles the interrupt of the MCP2515 a transaction must
+ * not be interrupted by it.
+ */
+#define	MCP2515_CS_LOW		HAL_CS_LOW(MCP2515_CS)
+#define	MCP2515_CS_HIGH		HAL_CS_HIGH(MCP2515_CS)
+
+#ifdef	MCP2515_INT_VECTOR
+	#define	MCP2515_SELECT		CAN_ENTER_CRITICAL_SECTION; MCP2515_CS_LOW
+	#define	MCP2515_DESELECT	MCP2515_CS_HIGH; CAN_LEAVE_CRITICAL_SECTION
+#else
+	#define	MCP2515_SELECT		MCP2515_CS_LOW
+	#define	MCP2515_DESELECT	MCP2515_CS_HIGH
+#endif
+
+#ifdef	MCP2515_INT_VECTOR
+#include "can_buffer.h"
+
+extern can_buffer_t can_rx_buffer;
+extern can_t can_rx_list[CAN_RX_BUFFER_SIZE];
+
+extern uint8_t mcp2515_get_buffered_message(can_t *msg);
+
+#if SUPPORT_TIMESTAMPS
+extern volatile uint8_t _mcp2515_timestamp_flag;
+extern volatile uint16_t _mcp2515_tx_timestamp;
+extern volatile bool _mcp2515_tx_timestamp_valid;
+#endif
+#endif
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Stop waiting for the timestamp of a transmit buffer
+ *
+ * Has to be called if the message in the buffer (0..2) was aborted or
+ * failed, TXnIF is never set for it in this case.
+ */
+#if defined(MCP2515_INT_VECTOR) && SUPPORT_TIMESTAMPS
+extern void mcp2515_release_timestamp(uint8_t buffer);
+#else
+#define	mcp2515_release_timestamp(buffer)
+#endif
+
 // -------------------------------------------------------------------------
 /**
  * \brief	Beschreiben von internen Registern
@@ -153,24 +208,125 @@ extern __attribute__ ((gnu_inline)) inline void mcp2515_change_operation_mode(ui
 		;
 }
 
+// -------------------------------------------------------------------------
+/**
+ * \brief	One-shot mode
+ *
+ * _mcp2515_one_shot_pending holds the SPI_RTS codes of the buffers which
+ * were sent in one-shot mode and whose result wasn't checked yet.
+ */
+extern bool _mcp2515_one_shot;
+extern uint8_t _mcp2515_one_shot_pending;
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Report failed one-shot transmissions
+ *
+ * \param	status	Result of mcp2515_read_status(SPI_READ_STATUS)
+ */
+extern void mcp2515_check_one_shot(uint8_t status);
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Buffers sent with raised priority by can_send_message_preemptive()
+ *
+ * _mcp2515_urgent_buffers holds their TXREQ bits of the status byte
+ * (2, 4 or 6). Once they are sent, mcp2515_restore_tx_priority() resets
+ * TXP to 0 so that the buffers are used in their normal order again.
+ *
+ * \param	status	Result of mcp2515_read_status(SPI_READ_STATUS)
+ */
+extern uint8_t _mcp2515_urgent_buffers;
+
+extern void mcp2515_restore_tx_priority(uint8_t status);
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Search a free transmit buffer
+ *
+ * \return	Offset of the buffer for SPI_WRITE_TX (0x00, 0x02 or 0x04),
+ *			0xff if all buffers are in use
+ */
+extern __attribute__ ((gnu_inline)) inline uint8_t mcp2515_get_free_tx_buffer(void)
+{
+	uint8_t status = mcp2515_read_status(SPI_READ_STATUS);
+	
+	if (_mcp2515_one_shot_pending)
+		mcp2515_check_one_shot(status);
+	
+	if (_mcp2515_urgent_buffers)
+		mcp2515_restore_tx_priority(status);
+	
+	/* Statusbyte:
+	 *
+	 * Bit	Funktion
+	 *  2	TXB0CNTRL.TXREQ
+	 *  4	TXB1CNTRL.TXREQ
+	 *  6	TXB2CNTRL.TXREQ
+	 */
+	if (_bit_is_clear(status, 2)) {
+		return 0x00;
+	}
+	else if (_bit_is_clear(status, 4)) {
+		return 0x02;
+	}
+	#if MCP2515_TX_BUFFERS > 2
+	else if (_bit_is_clear(status, 6)) {
+		return 0x04;
+	}
+	#endif
+	
+	return 0xff;
+}
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Load a message into a transmit buffer and request its transmission
+ *
+ * \param	address	Offset of the buffer for SPI_WRITE_TX (0x00, 0x02 or 0x04)
+ * \return	Code of the buffer for SPI_RTS (1, 2 or 4)
+ */
+extern uint8_t mcp2515_start_transmission(uint8_t address, const can_t *msg);
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Read back the content of a transmit buffer
+ *
+ * \param	buffer	Number of the buffer (0..2)
+ */
+extern void mcp2515_read_tx_buffer(uint8_t buffer, can_t *msg);
+
 // -------------------------------------------------------------------------
 /**
  * \brief	Liest bzw. schreibt eine CAN-Id zum MCP2515
+ *
+ * mcp2515_read_id() decodes the registers SIDH, SIDL, EID8 and EID0
+ * which were read before with spi_read().
  */
 #if	SUPPORT_EXTENDED_CANID
 
 extern void mcp2515_write_id( const uint32_t *id, uint8_t extended );
 
-extern uint8_t mcp2515_read_id( uint32_t *id );
+extern uint8_t mcp2515_read_id( const uint8_t *reg, uint32_t *id );
 
 #else
 
 extern void mcp2515_write_id( const uint16_t *id );
 
-extern uint8_t mcp2515_read_id( uint16_t *id );
+extern uint8_t mcp2515_read_id( const uint8_t *reg, uint16_t *id );
 
 #endif	// USE_EXTENDED_CANID
 
+#if defined(SPI_SPIDEV) && defined(MCP2515_INT_GPIO)
+// -------------------------------------------------------------------------
+/**
+ * \brief	Request the GPIO connected to the INT pin (Linux)
+ */
+extern bool mcp2515_int_init(void);
+
+extern bool mcp2515_int_active(void);
+#endif
+
 #endif  // SUPPORT_FOR_MCP2515__
 
 #endif	// MCP2515_PRIVATE_H
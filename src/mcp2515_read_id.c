@@ -33,78 +33,52 @@
 
 // ----------------------------------------------------------------------------
 // Liest eine ID aus dem Registern des MCP2515 (siehe auch mcp2515_write_id())
+// 
+// reg[0..3] contains SIDH, SIDL, EID8 and EID0
 
 #if	SUPPORT_EXTENDED_CANID
 
-uint8_t mcp2515_read_id(uint32_t *id)
+uint8_t mcp2515_read_id(const uint8_t *reg, uint32_t *id)
 {
-	uint8_t first;
-	uint8_t tmp;
-	
-	first = spi_putc(0xff);
-	tmp   = spi_putc(0xff);
+	uint8_t first = reg[0];
+	uint8_t tmp   = reg[1];
 	
 	if (tmp & (1 << IDE)) {
-		spi_start(0xff);
-		
 		*((uint16_t *) id + 1)  = (uint16_t) first << 5;
-		*((uint8_t *)  id + 1)  = spi_wait();
-		spi_start(0xff);
+		*((uint8_t *)  id + 1)  = reg[2];
 		
 		*((uint8_t *)  id + 2) |= (tmp >> 3) & 0x1C;
 		*((uint8_t *)  id + 2) |=  tmp & 0x03;
 		
-		*((uint8_t *)  id)      = spi_wait();
+		*((uint8_t *)  id)      = reg[3];
 		
 		return TRUE;
 	}
 	else {
-		spi_start(0xff);
-		
 		*((uint8_t *)  id + 3) = 0;
 		*((uint8_t *)  id + 2) = 0;
 		
 		*((uint16_t *) id) = (uint16_t) first << 3;
-		
-		spi_wait();
-		spi_start(0xff);
-		
 		*((uint8_t *) id) |= tmp >> 5;
 		
-		spi_wait();
-		
 		return FALSE;
 	}
 }
 
 #else
 
-uint8_t mcp2515_read_id(uint16_t *id)
+uint8_t mcp2515_read_id(const uint8_t *reg, uint16_t *id)
 {
-	uint8_t first;
-	uint8_t tmp;
-	
-	first = spi_putc(0xff);
-	tmp   = spi_putc(0xff);
+	uint8_t first = reg[0];
+	uint8_t tmp   = reg[1];
 	
 	if (tmp & (1 << IDE)) {
-		spi_putc(0xff);
-		spi_putc(0xff);
-		
 		return 1;			// extended-frame
 	}
 	else {
-		spi_start(0xff);
-		
 		*id = (uint16_t) first << 3;
-		
-		spi_wait();
-		spi_start(0xff);
-		
 		*((uint8_t *) id) |= tmp >> 5;
 		
-		spi_wait();
-		
 		if (tmp & (1 << SRR))
 			return 2;		// RTR-frame
 		else
@@ -36,33 +36,25 @@
 // ----------------------------------------------------------------------------
 uint8_t mcp2515_send_message(const can_t *msg)
 {
-	// Status des MCP2515 auslesen
-	uint8_t status = mcp2515_read_status(SPI_READ_STATUS);
-	
-	/* Statusbyte:
-	 *
-	 * Bit	Funktion
-	 *  2	TXB0CNTRL.TXREQ
-	 *  4	TXB1CNTRL.TXREQ
-	 *  6	TXB2CNTRL.TXREQ
-	 */
-	uint8_t address;
-	if (_bit_is_clear(status, 2)) {
-		address = 0x00;
-	}
-	else if (_bit_is_clear(status, 4)) {
-		address = 0x02;
-	} 
-	else if (_bit_is_clear(status, 6)) {
-		address = 0x04;
-	}
-	else {
+	uint8_t address = mcp2515_get_free_tx_buffer();
+	if (address == 0xff) {
 		// Alle Puffer sind belegt,
 		// Nachricht kann nicht verschickt werden
 		return 0;
 	}
 	
-	RESET(MCP2515_CS);
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit(msg))
+		return 0;
+	#endif
+	
+	return mcp2515_start_transmission(address, msg);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t mcp2515_start_transmission(uint8_t address, const can_t *msg)
+{
+	MCP2515_SELECT;
 	spi_putc(SPI_WRITE_TX | address);
 	#if SUPPORT_EXTENDED_CANID
 		mcp2515_write_id(&msg->id, msg->flags.extended);
@@ -90,17 +82,23 @@ uint8_t mcp2515_send_message(const can_t *msg)
 			spi_putc(msg->data[i]);
 		}
 	}
-	SET(MCP2515_CS);
+	MCP2515_DESELECT;
 	
 	_delay_us(1);
 	
 	// CAN Nachricht verschicken
 	// die letzten drei Bit im RTS Kommando geben an welcher
 	// Puffer gesendet werden soll.
-	RESET(MCP2515_CS);
+	MCP2515_SELECT;
 	address = (address == 0) ? 1 : address;
 	spi_putc(SPI_RTS | address);
-	SET(MCP2515_CS);
+	MCP2515_DESELECT;
+	
+	if (_mcp2515_one_shot) {
+		CAN_ENTER_CRITICAL_SECTION;
+		_mcp2515_one_shot_pending |= address;
+		CAN_LEAVE_CRITICAL_SECTION;
+	}
 	
 	CAN_INDICATE_TX_TRAFFIC_FUNCTION;
 	
@@ -96,7 +96,7 @@ bool mcp2515_set_filter(uint8_t number, const can_filter_t *filter)
 	
 	if (mask_address)
 	{
-		RESET(MCP2515_CS);
+		MCP2515_SELECT;
 		spi_putc(SPI_WRITE);
 		spi_putc(mask_address);
 		#if SUPPORT_EXTENDED_CANID
@@ -104,7 +104,7 @@ bool mcp2515_set_filter(uint8_t number, const can_filter_t *filter)
 		#else
 			mcp2515_write_id(&filter->mask);
 		#endif
-		SET(MCP2515_CS);
+		MCP2515_DESELECT;
 		
 		_delay_us(1);
 	}
@@ -119,7 +119,7 @@ bool mcp2515_set_filter(uint8_t number, const can_filter_t *filter)
 		filter_address = RXF0SIDH;
 	}
 	
-	RESET(MCP2515_CS);
+	MCP2515_SELECT;
 	spi_putc(SPI_WRITE);
 	spi_putc(filter_address | (number * 4));
 	#if SUPPORT_EXTENDED_CANID
@@ -127,7 +127,7 @@ bool mcp2515_set_filter(uint8_t number, const can_filter_t *filter)
 	#else
 		mcp2515_write_id(&filter->id);
 	#endif
-	SET(MCP2515_CS);
+	MCP2515_DESELECT;
 	
 	_delay_us(1);
 	
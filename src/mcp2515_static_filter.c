@@ -47,7 +47,7 @@ void mcp2515_static_filter(const uint8_t *filter)
 	uint8_t i, j;
 	for (i = 0; i < 0x30; i += 0x10)
 	{
-		RESET(MCP2515_CS);
+		MCP2515_CS_LOW;
 		spi_putc(SPI_WRITE);
 		spi_putc(i);
 		
@@ -58,7 +58,7 @@ void mcp2515_static_filter(const uint8_t *filter)
 			
 			spi_putc(pgm_read_byte(filter++));
 		}
-		SET(MCP2515_CS);
+		MCP2515_CS_HIGH;
 	}
 	
 	mcp2515_bit_modify(CANCTRL, 0xe0, 0);
@@ -78,7 +78,7 @@ void mcp2515_static_filter2(uint8_t *filter)
 	uint8_t i, j;
 	for (i = 0; i < 0x30; i += 0x10)
 	{
-		RESET(MCP2515_CS);
+		MCP2515_CS_LOW;
 		spi_putc(SPI_WRITE);
 		spi_putc(i);
 		
@@ -89,7 +89,7 @@ void mcp2515_static_filter2(uint8_t *filter)
 			
 			spi_putc(*(filter++));
 		}
-		SET(MCP2515_CS);
+		MCP2515_CS_HIGH;
 	}
 	
 	mcp2515_bit_modify(CANCTRL, 0xe0, 0);
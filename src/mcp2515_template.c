@@ -0,0 +1,123 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2515_private.h"
+#ifdef	SUPPORT_FOR_MCP2515__
+
+#include <util/delay.h>
+
+// ----------------------------------------------------------------------------
+// The header is stored in the same order as the registers TXBnSIDH .. TXBnDLC,
+// so it can be written with a single SPI_WRITE_TX command.
+
+void mcp2515_prepare_template(can_template_t *tpl, const can_t *msg)
+{
+	uint8_t length = msg->length & 0x0f;
+	if (length > 8)
+		length = 8;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if (msg->flags.extended)
+	{
+		tpl->header[0] = msg->id >> 21;
+		tpl->header[1] = ((msg->id >> 13) & 0xe0) | (1 << IDE) |
+						 ((msg->id >> 16) & 0x03);
+		tpl->header[2] = msg->id >> 8;
+		tpl->header[3] = msg->id;
+	}
+	else
+	#endif
+	{
+		tpl->header[0] = msg->id >> 3;
+		tpl->header[1] = msg->id << 5;
+		tpl->header[2] = 0;
+		tpl->header[3] = 0;
+	}
+	
+	if (msg->flags.rtr)
+		tpl->header[4] = (1 << RTR) | length;
+	else
+		tpl->header[4] = length;
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	_can_rate_limit_prepare(tpl, msg);
+	#endif
+}
+
+// ----------------------------------------------------------------------------
+uint8_t mcp2515_send_template(const can_template_t *tpl, const uint8_t *data)
+{
+	uint8_t address = mcp2515_get_free_tx_buffer();
+	if (address == 0xff)
+		return 0;
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit_template(tpl))
+		return 0;
+	#endif
+	
+	MCP2515_SELECT;
+	spi_putc(SPI_WRITE_TX | address);
+	
+	// ID and DLC
+	for (uint8_t i = 0; i < 5; i++) {
+		spi_putc(tpl->header[i]);
+	}
+	
+	// a RTR message has a length but contains no data
+	if (!(tpl->header[4] & (1 << RTR)))
+	{
+		uint8_t length = tpl->header[4] & 0x0f;
+		for (uint8_t i = 0; i < length; i++) {
+			spi_putc(data[i]);
+		}
+	}
+	MCP2515_DESELECT;
+	
+	_delay_us(1);
+	
+	// send buffer
+	MCP2515_SELECT;
+	address = (address == 0) ? 1 : address;
+	spi_putc(SPI_RTS | address);
+	MCP2515_DESELECT;
+	
+	if (_mcp2515_one_shot) {
+		CAN_ENTER_CRITICAL_SECTION;
+		_mcp2515_one_shot_pending |= address;
+		CAN_LEAVE_CRITICAL_SECTION;
+	}
+	
+	CAN_INDICATE_TX_TRAFFIC_FUNCTION;
+	
+	return address;
+}
+
+#endif	// SUPPORT_FOR_MCP2515__
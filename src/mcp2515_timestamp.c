@@ -0,0 +1,108 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2515_private.h"
+#if defined(SUPPORT_FOR_MCP2515__) && defined(MCP2515_INT_VECTOR) && SUPPORT_TIMESTAMPS
+
+// ----------------------------------------------------------------------------
+// The interrupt of the transmit buffer is enabled only for this message,
+// the ISR takes the timestamp and disables it again.
+
+uint8_t mcp2515_send_timestamped_message(const can_t *msg)
+{
+	uint8_t pending = _mcp2515_timestamp_flag;
+	if (pending != 0)
+	{
+		// TX0IF => TXB0, TX1IF => TXB1, TX2IF => TXB2
+		uint8_t buffer = (pending >> TX0IF) >> 1;
+		
+		if ((mcp2515_read_register(TXB0CTRL + (buffer << 4)) & (1<<TXREQ)) ||
+				(mcp2515_read_register(CANINTF) & pending)) {
+			// previous message not sent yet or its interrupt is pending
+			return 0;
+		}
+		
+		// the previous message was aborted, it won't get a timestamp
+		mcp2515_release_timestamp(buffer);
+	}
+	
+	uint8_t address = mcp2515_get_free_tx_buffer();
+	if (address == 0xff)
+		return 0;
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit(msg))
+		return 0;
+	#endif
+	
+	// TXB0 => TX0IF, TXB1 => TX1IF, TXB2 => TX2IF
+	uint8_t flag = (1 << TX0IF) << (address >> 1);
+	
+	// TXnIF is still set from previous transmissions
+	mcp2515_bit_modify(CANINTF, flag, 0);
+	
+	_mcp2515_tx_timestamp_valid = false;
+	_mcp2515_timestamp_flag = flag;
+	mcp2515_bit_modify(CANINTE, flag, flag);
+	
+	return mcp2515_start_transmission(address, msg);
+}
+
+// ----------------------------------------------------------------------------
+void mcp2515_release_timestamp(uint8_t buffer)
+{
+	uint8_t flag = (1 << TX0IF) << buffer;
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	if (_mcp2515_timestamp_flag == flag)
+	{
+		mcp2515_bit_modify(CANINTE, flag & ~(MCP2515_INTERRUPTS), 0);
+		_mcp2515_timestamp_flag = 0;
+	}
+	CAN_LEAVE_CRITICAL_SECTION;
+}
+
+// ----------------------------------------------------------------------------
+bool mcp2515_get_tx_timestamp(uint16_t *timestamp)
+{
+	bool valid;
+	
+	CAN_ENTER_CRITICAL_SECTION;
+	valid = _mcp2515_tx_timestamp_valid;
+	if (valid) {
+		*timestamp = _mcp2515_tx_timestamp;
+		_mcp2515_tx_timestamp_valid = false;
+	}
+	CAN_LEAVE_CRITICAL_SECTION;
+	
+	return valid;
+}
+
+#endif	// SUPPORT_FOR_MCP2515__
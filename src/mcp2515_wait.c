@@ -0,0 +1,147 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2515_private.h"
+#if defined(SUPPORT_FOR_MCP2515__) && defined(SPI_SPIDEV)
+
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef	MCP2515_INT_GPIO
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+static int _mcp2515_int_fd = -1;
+
+// ----------------------------------------------------------------------------
+// Request the INT pin as input with falling edge events
+
+bool mcp2515_int_init(void)
+{
+	struct gpio_v2_line_request request;
+	
+	if (_mcp2515_int_fd >= 0)
+		return true;
+	
+	int chip = open(MCP2515_INT_GPIOCHIP, O_RDONLY);
+	if (chip < 0)
+		return false;
+	
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = MCP2515_INT_GPIO;
+	request.num_lines = 1;
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+						   GPIO_V2_LINE_FLAG_EDGE_FALLING |
+						   GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+	strncpy(request.consumer, "mcp2515", sizeof(request.consumer) - 1);
+	
+	int result = ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &request);
+	close(chip);
+	
+	if (result < 0)
+		return false;
+	
+	_mcp2515_int_fd = request.fd;
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+bool mcp2515_int_active(void)
+{
+	struct gpio_v2_line_values values;
+	
+	values.bits = 0;
+	values.mask = 1;
+	
+	if (ioctl(_mcp2515_int_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+		// can't tell, let the caller ask the MCP2515
+		return true;
+	}
+	
+	return (values.bits & 1) ? false : true;
+}
+
+#endif	// MCP2515_INT_GPIO
+
+// ----------------------------------------------------------------------------
+static int32_t _elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return (now.tv_sec - start->tv_sec) * 1000 +
+		   (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+// ----------------------------------------------------------------------------
+// Sleep until a message was received or the timeout expired
+
+bool mcp2515_wait_message(int16_t timeout)
+{
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	while (!mcp2515_check_message())
+	{
+		int remaining = -1;
+		if (timeout >= 0)
+		{
+			remaining = timeout - _elapsed_ms(&start);
+			if (remaining <= 0)
+				return false;
+		}
+		
+		#ifdef	MCP2515_INT_GPIO
+			// The INT pin stays low as long as a message is waiting, the
+			// edge only wakes us up. Events queued before the check above
+			// lead to another check.
+			struct pollfd pfd = { .fd = _mcp2515_int_fd, .events = POLLIN };
+			struct gpio_v2_line_event events[4];
+			
+			if (poll(&pfd, 1, remaining) > 0) {
+				if (read(_mcp2515_int_fd, events, sizeof(events)) < 0)
+					return false;
+			}
+		#else
+			// without the INT pin the MCP2515 is polled every millisecond
+			(void) remaining;
+			usleep(1000);
+		#endif
+	}
+	
+	return true;
+}
+
+#endif	// SUPPORT_FOR_MCP2515__ && SPI_SPIDEV
@@ -0,0 +1,268 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2517fd_private.h"
+#ifdef	SUPPORT_FOR_MCP2517FD__
+
+// ----------------------------------------------------------------------------
+// Nominal bit timing (C1NBTCFG: SJW, TSEG2, TSEG1, BRP), all values are
+// decremented by one. Sample point at 80 %.
+
+#if MCP2517FD_CLOCK == 40
+
+const uint8_t _mcp2517fd_nbtcfg[8][4] PROGMEM = {
+	{ 39, 39, 158, 19 },	// 10 kbps, 200 TQ
+	{ 39, 39, 158,  9 },	// 20 kbps
+	{ 39, 39, 158,  3 },	// 50 kbps
+	{ 39, 39, 158,  1 },	// 100 kbps
+	{ 31, 31, 126,  1 },	// 125 kbps, 160 TQ
+	{ 31, 31, 126,  0 },	// 250 kbps
+	{ 15, 15,  62,  0 },	// 500 kbps, 80 TQ
+	{  7,  7,  30,  0 }		// 1 Mbps, 40 TQ
+};
+
+#if MCP2517FD_DATA_BITRATE == 1000
+	#define	DBT_TSEG1		30
+	#define	DBT_TSEG2		7
+#elif MCP2517FD_DATA_BITRATE == 2000
+	#define	DBT_TSEG1		14
+	#define	DBT_TSEG2		3
+#elif MCP2517FD_DATA_BITRATE == 4000
+	#define	DBT_TSEG1		6
+	#define	DBT_TSEG2		1
+#elif MCP2517FD_DATA_BITRATE == 5000
+	#define	DBT_TSEG1		4
+	#define	DBT_TSEG2		1
+#elif MCP2517FD_DATA_BITRATE == 8000
+	#define	DBT_TSEG1		2
+	#define	DBT_TSEG2		0
+#else
+	#error	MCP2517FD_DATA_BITRATE has to be 1000, 2000, 4000, 5000 or 8000
+#endif
+
+#elif MCP2517FD_CLOCK == 20
+
+const uint8_t _mcp2517fd_nbtcfg[8][4] PROGMEM = {
+	{ 39, 39, 158,  9 },	// 10 kbps, 200 TQ
+	{ 39, 39, 158,  4 },	// 20 kbps
+	{ 39, 39, 158,  1 },	// 50 kbps
+	{ 39, 39, 158,  0 },	// 100 kbps
+	{ 31, 31, 126,  0 },	// 125 kbps, 160 TQ
+	{ 15, 15,  62,  0 },	// 250 kbps, 80 TQ
+	{  7,  7,  30,  0 },	// 500 kbps, 40 TQ
+	{  3,  3,  14,  0 }		// 1 Mbps, 20 TQ
+};
+
+#if MCP2517FD_DATA_BITRATE == 1000
+	#define	DBT_TSEG1		14
+	#define	DBT_TSEG2		3
+#elif MCP2517FD_DATA_BITRATE == 2000
+	#define	DBT_TSEG1		6
+	#define	DBT_TSEG2		1
+#elif MCP2517FD_DATA_BITRATE == 4000
+	#define	DBT_TSEG1		2
+	#define	DBT_TSEG2		0
+#elif MCP2517FD_DATA_BITRATE == 5000
+	#define	DBT_TSEG1		1
+	#define	DBT_TSEG2		0
+#else
+	#error	MCP2517FD_DATA_BITRATE has to be 1000, 2000, 4000 or 5000 (20 MHz)
+#endif
+
+#else
+	#error	MCP2517FD_CLOCK has to be 20 or 40 (MHz)
+#endif
+
+// Data phase with a prescaler of 1, the transmitter delay compensation
+// measures the delay and adds the sample point (TDCO) to it.
+#define	DBT_SJW				DBT_TSEG2
+#define	TDC_OFFSET			(DBT_TSEG1 + 1)
+
+// ----------------------------------------------------------------------------
+
+static const uint8_t _mcp2517fd_fd_length[7] PROGMEM = {
+	12, 16, 20, 24, 32, 48, 64
+};
+
+// ----------------------------------------------------------------------------
+uint8_t mcp2517fd_dlc_to_length(uint8_t dlc)
+{
+	if (dlc <= 8)
+		return dlc;
+	
+	return pgm_read_byte(&_mcp2517fd_fd_length[dlc - 9]);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t mcp2517fd_length_to_dlc(uint8_t length)
+{
+	if (length <= 8)
+		return length;
+	
+	uint8_t dlc = 9;
+	while (dlc < 15 && pgm_read_byte(&_mcp2517fd_fd_length[dlc - 9]) < length)
+		dlc++;
+	
+	return dlc;
+}
+
+// ----------------------------------------------------------------------------
+void mcp2517fd_write_byte(uint16_t address, uint8_t data)
+{
+	mcp2517fd_start(FD_SPI_WRITE, address);
+	spi_putc(data);
+	HAL_CS_HIGH(MCP2517FD_CS);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t mcp2517fd_read_byte(uint16_t address)
+{
+	mcp2517fd_start(FD_SPI_READ, address);
+	uint8_t data = spi_putc(0xff);
+	HAL_CS_HIGH(MCP2517FD_CS);
+	
+	return data;
+}
+
+// ----------------------------------------------------------------------------
+void mcp2517fd_write_register(uint16_t address, uint32_t data)
+{
+	mcp2517fd_start(FD_SPI_WRITE, address);
+	for (uint8_t i = 0; i < 4; i++) {
+		spi_putc(data);
+		data >>= 8;
+	}
+	HAL_CS_HIGH(MCP2517FD_CS);
+}
+
+// ----------------------------------------------------------------------------
+bool mcp2517fd_change_operation_mode(uint8_t mode)
+{
+	mcp2517fd_write_byte(C1CON + 3, mode << C1CON_REQOP0);
+	
+	// leaving the normal mode waits for the end of the current message
+	for (uint16_t i = 0; i < 1000; i++)
+	{
+		if ((mcp2517fd_read_byte(C1CON + 2) >> C1CON_OPMOD0) == mode)
+			return true;
+		
+		_delay_us(20);
+	}
+	
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+bool mcp2517fd_init(can_bitrate_t bitrate)
+{
+	if (bitrate >= 8)
+		return false;
+	
+	HAL_CS_INIT(MCP2517FD_CS);
+	
+	spi_init();
+	
+	// software reset, afterwards the MCP2517FD is in configuration mode
+	mcp2517fd_start(FD_SPI_RESET, 0);
+	HAL_CS_HIGH(MCP2517FD_CS);
+	
+	// wait for the oscillator
+	uint8_t i = 0;
+	while (!(mcp2517fd_read_byte(FD_OSC + 1) & (1 << OSC_OSCRDY)))
+	{
+		if (++i == 0)
+			return false;
+		
+		_delay_us(100);
+	}
+	
+	// bit timing of both phases and the delay compensation
+	// (C1NBTCFG, C1DBTCFG, C1TDC) in one transfer
+	mcp2517fd_start(FD_SPI_WRITE, C1NBTCFG);
+	for (i = 0; i < 4; i++) {
+		spi_putc(pgm_read_byte(&_mcp2517fd_nbtcfg[bitrate][i]));
+	}
+	spi_putc(DBT_SJW);
+	spi_putc(DBT_TSEG2);
+	spi_putc(DBT_TSEG1);
+	spi_putc(0);
+	
+	spi_putc(0);
+	spi_putc(TDC_OFFSET);
+	spi_putc(FD_TDC_AUTO << C1TDC_TDCMOD0);
+	spi_putc(0);
+	HAL_CS_HIGH(MCP2517FD_CS);
+	
+	// check if the registers could be written
+	// (=> is the chip accessible at all?)
+	if (mcp2517fd_read_byte(C1NBTCFG + 2) != pgm_read_byte(&_mcp2517fd_nbtcfg[bitrate][2]))
+		return false;
+	
+	// no transmit queue and transmit event FIFO, unlimited retransmissions
+	mcp2517fd_write_byte(C1CON + 2, 0);
+	
+	#if SUPPORT_TIMESTAMPS
+	mcp2517fd_write_register(C1TSCON,
+			(1UL << (16 + C1TSCON_TBCEN)) | MCP2517FD_TIMESTAMP_PRESCALER);
+	#endif
+	
+	// transmit FIFO
+	mcp2517fd_write_register(C1FIFOCON(FD_TX_FIFO),
+			(1 << FIFOCON_TXEN) |
+			(3UL << (16 + FIFOCON_TXAT0)) |
+			((uint32_t) ((FD_PLSIZE << FIFOCON_PLSIZE0) |
+						 (MCP2517FD_TX_FIFO_SIZE - 1)) << 24));
+	
+	// receive FIFO, the INT pin is active as long as it isn't empty
+	mcp2517fd_write_register(C1FIFOCON(FD_RX_FIFO),
+			(1 << FIFOCON_TFNRFNIE) |
+			(SUPPORT_TIMESTAMPS << FIFOCON_RXTSEN) |
+			((uint32_t) ((FD_PLSIZE << FIFOCON_PLSIZE0) |
+						 (MCP2517FD_RX_FIFO_SIZE - 1)) << 24));
+	
+	mcp2517fd_write_byte(C1INT + 2, (1 << C1INT_RXIE));
+	
+	// filter 0 accepts all messages
+	mcp2517fd_write_register(C1FLTOBJ(0), 0);
+	mcp2517fd_write_register(C1MASK(0), 0);
+	mcp2517fd_write_byte(C1FLTCON(0), (1 << FLTCON_FLTEN) | FD_RX_FIFO);
+	
+	#if defined(MCP2517FD_INT)
+		HAL_INPUT_INIT(MCP2517FD_INT);
+	#endif
+	
+	#if SUPPORT_CAN_FD
+	return mcp2517fd_change_operation_mode(FD_MODE_NORMAL_FD);
+	#else
+	return mcp2517fd_change_operation_mode(FD_MODE_NORMAL_20);
+	#endif
+}
+
+#endif	// SUPPORT_FOR_MCP2517FD__
@@ -0,0 +1,56 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2517fd_private.h"
+#ifdef	SUPPORT_FOR_MCP2517FD__
+
+// ----------------------------------------------------------------------------
+// check if there are any new messages waiting
+
+bool mcp2517fd_check_message(void)
+{
+	#if defined(MCP2517FD_INT)
+		return HAL_INPUT_IS_LOW(MCP2517FD_INT);
+	#else
+		return ((mcp2517fd_read_byte(C1FIFOSTA(FD_RX_FIFO)) &
+				(1 << FIFOSTA_TFNRFNIF)) ? true : false);
+	#endif
+}
+
+// ----------------------------------------------------------------------------
+// check if there is a free buffer to send messages
+
+bool mcp2517fd_check_free_buffer(void)
+{
+	return ((mcp2517fd_read_byte(C1FIFOSTA(FD_TX_FIFO)) &
+			(1 << FIFOSTA_TFNRFNIF)) ? true : false);
+}
+
+#endif	// SUPPORT_FOR_MCP2517FD__
@@ -0,0 +1,214 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id: mcp2515_defs.h 6611 2008-07-14 09:58:16Z fabian $
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	MCP2517FD_DEFS_H
+#define	MCP2517FD_DEFS_H
+
+// The registers are 32 bit wide and little endian. Most of them are
+// accessed bytewise, so the bits are given as position within the byte
+// named after the register (e.g. C1CON_3 => bits 24..31 of C1CON).
+
+/** \name	SPI instructions (upper 4 bit of the first byte) */
+/*@{*/
+#define	FD_SPI_RESET		0x00
+#define	FD_SPI_WRITE		0x20
+#define	FD_SPI_READ			0x30
+/*@}*/
+
+/** \name	CAN FD controller */
+/*@{*/
+#define	C1CON				0x000
+#define	C1NBTCFG			0x004
+#define	C1DBTCFG			0x008
+#define	C1TDC				0x00C
+#define	C1TBC				0x010
+#define	C1TSCON				0x014
+#define	C1VEC				0x018
+#define	C1INT				0x01C
+#define	C1RXIF				0x020
+#define	C1TXIF				0x024
+#define	C1RXOVIF			0x028
+#define	C1TXATIF			0x02C
+#define	C1TXREQ				0x030
+#define	C1TREC				0x034
+#define	C1BDIAG0			0x038
+#define	C1BDIAG1			0x03C
+#define	C1TEFCON			0x040
+#define	C1TEFSTA			0x044
+#define	C1TEFUA				0x048
+#define	C1TXQCON			0x050
+#define	C1TXQSTA			0x054
+#define	C1TXQUA				0x058
+
+// FIFO 1..31
+#define	C1FIFOCON(m)		(0x05C + 12 * ((m) - 1))
+#define	C1FIFOSTA(m)		(0x060 + 12 * ((m) - 1))
+#define	C1FIFOUA(m)			(0x064 + 12 * ((m) - 1))
+
+// filter 0..31
+#define	C1FLTCON(n)			(0x1D0 + (n))
+#define	C1FLTOBJ(n)			(0x1F0 + 8 * (n))
+#define	C1MASK(n)			(0x1F4 + 8 * (n))
+
+// message RAM
+#define	FD_RAM_START		0x400
+#define	FD_RAM_SIZE			2048
+/*@}*/
+
+/** \name	Device configuration */
+/*@{*/
+#define	FD_OSC				0xE00
+#define	FD_IOCON			0xE04
+#define	FD_CRC				0xE08
+#define	FD_ECCCON			0xE0C
+#define	FD_ECCSTAT			0xE10
+/*@}*/
+
+/** \name	Bits of C1CON */
+/*@{*/
+// byte 0 and 1
+#define	C1CON_ISOCRCEN		5
+#define	C1CON_PXEDIS		6
+#define	C1CON_BRSDIS		4		// byte 1
+
+// byte 2
+#define	C1CON_RTXAT			0
+#define	C1CON_ESIGM			1
+#define	C1CON_SERR2LOM		2
+#define	C1CON_STEF			3
+#define	C1CON_TXQEN			4
+#define	C1CON_OPMOD0		5
+
+// byte 3
+#define	C1CON_REQOP0		0
+#define	C1CON_ABAT			3
+
+// values of REQOP and OPMOD
+#define	FD_MODE_NORMAL_FD	0
+#define	FD_MODE_SLEEP		1
+#define	FD_MODE_LOOPBACK	2
+#define	FD_MODE_LISTEN_ONLY	3
+#define	FD_MODE_CONFIG		4
+#define	FD_MODE_NORMAL_20	6
+/*@}*/
+
+/** \name	Bits of C1TDC (byte 2) */
+/*@{*/
+#define	C1TDC_TDCMOD0		0
+#define	FD_TDC_AUTO			2
+/*@}*/
+
+/** \name	Bits of C1TSCON (byte 2) */
+/*@{*/
+#define	C1TSCON_TBCEN		0
+/*@}*/
+
+/** \name	Bits of C1INT (byte 2, interrupt enables) */
+/*@{*/
+#define	C1INT_TXIE			0
+#define	C1INT_RXIE			1
+#define	C1INT_RXOVIE		3		// byte 3
+#define	C1INT_RXOVIF		3		// byte 1
+/*@}*/
+
+/** \name	Bits of C1TREC (byte 2) */
+/*@{*/
+#define	C1TREC_EWARN		0
+#define	C1TREC_TXBO			5
+/*@}*/
+
+/** \name	Bits of C1FIFOCONm */
+/*@{*/
+// byte 0
+#define	FIFOCON_TFNRFNIE	0
+#define	FIFOCON_TFHRFHIE	1
+#define	FIFOCON_TFERFFIE	2
+#define	FIFOCON_RXOVIE		3
+#define	FIFOCON_TXATIE		4
+#define	FIFOCON_RXTSEN		5
+#define	FIFOCON_RTREN		6
+#define	FIFOCON_TXEN		7
+
+// byte 1
+#define	FIFOCON_UINC		0
+#define	FIFOCON_TXREQ		1
+#define	FIFOCON_FRESET		2
+
+// byte 2
+#define	FIFOCON_TXPRI0		0
+#define	FIFOCON_TXAT0		5
+
+// byte 3
+#define	FIFOCON_FSIZE0		0
+#define	FIFOCON_PLSIZE0		5
+/*@}*/
+
+/** \name	Bits of C1FIFOSTAm (byte 0) */
+/*@{*/
+#define	FIFOSTA_TFNRFNIF	0
+#define	FIFOSTA_TFHRFHIF	1
+#define	FIFOSTA_TFERFFIF	2
+#define	FIFOSTA_RXOVIF		3
+#define	FIFOSTA_TXATIF		4
+#define	FIFOSTA_TXERR		5
+#define	FIFOSTA_TXLARB		6
+#define	FIFOSTA_TXABT		7
+/*@}*/
+
+/** \name	Bits of C1FLTCONm */
+/*@{*/
+#define	FLTCON_FBP0			0
+#define	FLTCON_FLTEN		7
+/*@}*/
+
+/** \name	Bits of C1FLTOBJm and C1MASKm (byte 3) */
+/*@{*/
+#define	FLTOBJ_SID11		5
+#define	FLTOBJ_EXIDE		6
+#define	MASK_MSID11			5
+#define	MASK_MIDE			6
+/*@}*/
+
+/** \name	Bits of FD_OSC (byte 1) */
+/*@{*/
+#define	OSC_PLLRDY			0
+#define	OSC_OSCRDY			2
+#define	OSC_SCLKRDY			4
+/*@}*/
+
+/** \name	Flags of a message object (byte 0 of T1/R1) */
+/*@{*/
+#define	OBJ_IDE				4
+#define	OBJ_RTR				5
+#define	OBJ_BRS				6
+#define	OBJ_FDF				7
+/*@}*/
+
+#endif	// MCP2517FD_DEFS_H
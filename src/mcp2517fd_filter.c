@@ -0,0 +1,106 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2517fd_private.h"
+#ifdef	SUPPORT_FOR_MCP2517FD__
+
+// ----------------------------------------------------------------------------
+bool mcp2517fd_set_filter(uint8_t number, const can_filter_t *filter)
+{
+	if (number > 31)
+		return false;
+	
+	uint32_t id, mask;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if (filter->flags.extended == 0x3) {
+		// only extended identifier
+		id = ((filter->id >> 18) & 0x7ff) | ((filter->id & 0x3ffff) << 11);
+		mask = ((filter->mask >> 18) & 0x7ff) | ((filter->mask & 0x3ffff) << 11);
+		
+		id |= (1UL << (24 + FLTOBJ_EXIDE));
+		mask |= (1UL << (24 + MASK_MIDE));
+	}
+	else
+	#endif
+	{
+		id = filter->id & 0x7ff;
+		mask = filter->mask & 0x7ff;
+		
+		#if SUPPORT_EXTENDED_CANID
+		if (filter->flags.extended == 0x2) {
+			// only standard identifier
+			mask |= (1UL << (24 + MASK_MIDE));
+		}
+		#endif
+	}
+	
+	// the filter has to be disabled while it is changed
+	mcp2517fd_write_byte(C1FLTCON(number), 0);
+	
+	mcp2517fd_start(FD_SPI_WRITE, C1FLTOBJ(number));
+	for (uint8_t i = 0; i < 4; i++) {
+		spi_putc(id);
+		id >>= 8;
+	}
+	for (uint8_t i = 0; i < 4; i++) {
+		spi_putc(mask);
+		mask >>= 8;
+	}
+	HAL_CS_HIGH(MCP2517FD_CS);
+	
+	mcp2517fd_write_byte(C1FLTCON(number), (1 << FLTCON_FLTEN) | FD_RX_FIFO);
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+bool mcp2517fd_disable_filter(uint8_t number)
+{
+	if (number == 0xff)
+	{
+		// disable all filters
+		mcp2517fd_start(FD_SPI_WRITE, C1FLTCON(0));
+		for (uint8_t i = 0; i < 32; i++) {
+			spi_putc(0);
+		}
+		HAL_CS_HIGH(MCP2517FD_CS);
+		
+		return true;
+	}
+	else if (number > 31)
+		return false;
+	
+	mcp2517fd_write_byte(C1FLTCON(number), 0);
+	
+	return true;
+}
+
+#endif	// SUPPORT_FOR_MCP2517FD__
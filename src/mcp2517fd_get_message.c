@@ -0,0 +1,149 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2517fd_private.h"
+#ifdef	SUPPORT_FOR_MCP2517FD__
+
+// ----------------------------------------------------------------------------
+// Read the status of a FIFO and the address of the next message object
+// (C1FIFOSTAm and C1FIFOUAm) with one transfer.
+
+uint16_t mcp2517fd_fifo_address(uint8_t fifo)
+{
+	mcp2517fd_start(FD_SPI_READ, C1FIFOSTA(fifo));
+	uint8_t status = spi_putc(0xff);
+	for (uint8_t i = 0; i < 3; i++) {
+		spi_putc(0xff);
+	}
+	uint16_t address = spi_putc(0xff);
+	address |= (uint16_t) spi_putc(0xff) << 8;
+	HAL_CS_HIGH(MCP2517FD_CS);
+	
+	if (!(status & (1 << FIFOSTA_TFNRFNIF)))
+		return 0;
+	
+	return FD_RAM_START + address;
+}
+
+// ----------------------------------------------------------------------------
+
+uint8_t mcp2517fd_get_message(can_t *msg)
+{
+	uint16_t address = mcp2517fd_fifo_address(FD_RX_FIFO);
+	if (address == 0) {
+		// Error: no message available
+		return 0;
+	}
+	
+	// read the whole message object
+	mcp2517fd_start(FD_SPI_READ, address);
+	
+	uint32_t id = spi_putc(0xff);
+	id |= (uint32_t) spi_putc(0xff) << 8;
+	id |= (uint32_t) spi_putc(0xff) << 16;
+	id |= (uint32_t) spi_putc(0xff) << 24;
+	
+	uint8_t flags = spi_putc(0xff);
+	uint8_t filter = spi_putc(0xff) >> 3;
+	spi_putc(0xff);
+	spi_putc(0xff);
+	
+	#if SUPPORT_TIMESTAMPS
+		msg->timestamp = spi_putc(0xff);
+		msg->timestamp |= (uint16_t) spi_putc(0xff) << 8;
+		spi_putc(0xff);
+		spi_putc(0xff);
+	#endif
+	
+	uint8_t length = mcp2517fd_dlc_to_length(flags & 0x0f);
+	if (length > FD_PAYLOAD)
+		length = FD_PAYLOAD;
+	
+	if (!(flags & (1 << OBJ_RTR))) {
+		for (uint8_t i = 0; i < length; i++) {
+			msg->data[i] = spi_putc(0xff);
+		}
+	}
+	HAL_CS_HIGH(MCP2517FD_CS);
+	
+	// release the message object
+	mcp2517fd_write_byte(C1FIFOCON(FD_RX_FIFO) + 1, (1 << FIFOCON_UINC));
+	
+	if (flags & (1 << OBJ_IDE))
+	{
+		#if SUPPORT_EXTENDED_CANID
+			msg->id = ((id & 0x7ff) << 18) | ((id >> 11) & 0x3ffff);
+			msg->flags.extended = 1;
+		#else
+			// Nachrichten mit extended ID verwerfen
+			return 0;
+		#endif
+	}
+	else {
+		msg->id = id & 0x7ff;
+		#if SUPPORT_EXTENDED_CANID
+			msg->flags.extended = 0;
+		#endif
+	}
+	
+	msg->flags.rtr = (flags & (1 << OBJ_RTR)) ? 1 : 0;
+	#if SUPPORT_CAN_FD
+		msg->flags.fd = (flags & (1 << OBJ_FDF)) ? 1 : 0;
+		msg->flags.brs = (flags & (1 << OBJ_BRS)) ? 1 : 0;
+	#endif
+	msg->length = length;
+	
+	CAN_INDICATE_RX_TRAFFIC_FUNCTION;
+	
+	#if CAN_AUTO_REPLY_SLOTS > 0
+	if (msg->flags.rtr && _can_auto_reply(msg)) {
+		// remote frame was already answered
+		return 0;
+	}
+	#endif
+	
+	#if CAN_MAILBOX_SLOTS > 0
+	if (_can_mailbox_update(msg)) {
+		// message was stored in a mailbox
+		return 0;
+	}
+	#endif
+	
+	#if CAN_CHANGE_FILTER_SLOTS > 0
+	if (_can_suppress_unchanged(msg)) {
+		// content didn't change since the last message
+		return 0;
+	}
+	#endif
+	
+	return filter + 1;
+}
+
+#endif	// SUPPORT_FOR_MCP2517FD__
@@ -0,0 +1,167 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id: mcp2515_private.h 6910 2008-11-30 21:13:14Z fabian $
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	MCP2517FD_PRIVATE_H
+#define	MCP2517FD_PRIVATE_H
+
+// ----------------------------------------------------------------------------
+/**
+ * \brief	defines only used inside the library (MCP2517FD/MCP2518FD)
+ *
+ * FIFO 1 is used for transmission, FIFO 2 for reception. All messages
+ * accepted by a filter are stored in FIFO 2. The transmit queue and the
+ * transmit event FIFO are disabled.
+ */
+// ----------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "can.h"
+#include "utils.h"
+
+#include "can_private.h"
+#include "hal.h"
+
+#if (BUILD_FOR_MCP2517FD == 1) && defined(SUPPORT_FOR_SPI__)
+	#define	SUPPORT_FOR_MCP2517FD__
+#endif
+
+#ifdef	SUPPORT_FOR_MCP2517FD__
+
+#include "mcp2517fd_defs.h"
+
+// ----------------------------------------------------------------------------
+// load some default values
+
+#ifndef	MCP2517FD_CS
+	#error	MCP2517FD_CS is not defined!
+#endif
+
+// frequency of the oscillator (SYSCLK) in MHz
+#ifndef	MCP2517FD_CLOCK
+	#define	MCP2517FD_CLOCK				40
+#endif
+
+// bit rate of the data phase in kbps
+#ifndef	MCP2517FD_DATA_BITRATE
+	#define	MCP2517FD_DATA_BITRATE		2000
+#endif
+
+#ifndef	MCP2517FD_TX_FIFO_SIZE
+	#define	MCP2517FD_TX_FIFO_SIZE		8
+#endif
+
+#ifndef	MCP2517FD_RX_FIFO_SIZE
+	#define	MCP2517FD_RX_FIFO_SIZE		16
+#endif
+
+// prescaler of the time base counter for the timestamps,
+// SYSCLK / (prescaler + 1), default 1 us
+#ifndef	MCP2517FD_TIMESTAMP_PRESCALER
+	#define	MCP2517FD_TIMESTAMP_PRESCALER	(MCP2517FD_CLOCK - 1)
+#endif
+
+#if MCP2517FD_TX_FIFO_SIZE < 1 || MCP2517FD_TX_FIFO_SIZE > 32 || \
+	MCP2517FD_RX_FIFO_SIZE < 1 || MCP2517FD_RX_FIFO_SIZE > 32
+	#error	the size of the FIFOs has to be 1..32 messages
+#endif
+
+// ----------------------------------------------------------------------------
+// layout of the message RAM
+
+#define	FD_TX_FIFO					1
+#define	FD_RX_FIFO					2
+
+#if SUPPORT_CAN_FD
+	#define	FD_PAYLOAD				64
+	#define	FD_PLSIZE				7
+#else
+	#define	FD_PAYLOAD				8
+	#define	FD_PLSIZE				0
+#endif
+
+// object header (ID, flags) + optional timestamp + payload
+#define	FD_TX_OBJECT_SIZE			(8 + FD_PAYLOAD)
+#define	FD_RX_OBJECT_SIZE			(8 + 4 * SUPPORT_TIMESTAMPS + FD_PAYLOAD)
+
+#if (MCP2517FD_TX_FIFO_SIZE * FD_TX_OBJECT_SIZE + \
+	 MCP2517FD_RX_FIFO_SIZE * FD_RX_OBJECT_SIZE) > FD_RAM_SIZE
+	#error	the FIFOs are too large for the 2 KB message RAM of the MCP2517FD
+#endif
+
+// ----------------------------------------------------------------------------
+/**
+ * \brief	Start a SPI transaction for \a address
+ *
+ * The MCP2517FD increments the address automatically, so any number of
+ * bytes can be transferred afterwards with spi_putc(). The transaction
+ * ends with HAL_CS_HIGH(MCP2517FD_CS).
+ */
+extern __attribute__ ((gnu_inline)) inline void mcp2517fd_start(uint8_t instruction, uint16_t address)
+{
+	HAL_CS_LOW(MCP2517FD_CS);
+	spi_putc(instruction | (address >> 8));
+	spi_putc(address);
+}
+
+extern void mcp2517fd_write_byte(uint16_t address, uint8_t data);
+
+extern uint8_t mcp2517fd_read_byte(uint16_t address);
+
+extern void mcp2517fd_write_register(uint16_t address, uint32_t data);
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Address of the next message object of a FIFO
+ *
+ * \return	0 if the receive FIFO is empty or the transmit FIFO is full
+ */
+extern uint16_t mcp2517fd_fifo_address(uint8_t fifo);
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Request an operation mode and wait until it is active
+ */
+extern bool mcp2517fd_change_operation_mode(uint8_t mode);
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Convert between the DLC and the number of data bytes
+ */
+extern uint8_t mcp2517fd_dlc_to_length(uint8_t dlc);
+
+extern uint8_t mcp2517fd_length_to_dlc(uint8_t length);
+
+#endif	// SUPPORT_FOR_MCP2517FD__
+
+#endif	// MCP2517FD_PRIVATE_H
@@ -0,0 +1,122 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2517fd_private.h"
+#ifdef	SUPPORT_FOR_MCP2517FD__
+
+// ----------------------------------------------------------------------------
+uint8_t mcp2517fd_send_message(const can_t *msg)
+{
+	#if SUPPORT_CAN_FD
+	// there are no remote frames in CAN FD
+	if (msg->flags.fd && msg->flags.rtr)
+		return 0;
+	#endif
+	
+	uint16_t address = mcp2517fd_fifo_address(FD_TX_FIFO);
+	if (address == 0) {
+		// the transmit FIFO is full,
+		// message can't be send
+		return 0;
+	}
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit(msg))
+		return 0;
+	#endif
+	
+	uint32_t id;
+	uint8_t flags;
+	
+	#if SUPPORT_EXTENDED_CANID
+	if (msg->flags.extended) {
+		id = ((msg->id >> 18) & 0x7ff) | ((msg->id & 0x3ffff) << 11);
+		flags = (1 << OBJ_IDE);
+	}
+	else
+	#endif
+	{
+		id = msg->id & 0x7ff;
+		flags = 0;
+	}
+	
+	uint8_t length = msg->length;
+	if (length > FD_PAYLOAD)
+		length = FD_PAYLOAD;
+	
+	#if SUPPORT_CAN_FD
+	if (msg->flags.fd) {
+		flags |= (1 << OBJ_FDF);
+		if (msg->flags.brs)
+			flags |= (1 << OBJ_BRS);
+	}
+	else
+	#endif
+	if (length > 8)
+		length = 8;
+	
+	uint8_t dlc = mcp2517fd_length_to_dlc(length);
+	
+	if (msg->flags.rtr) {
+		// a remote frame has a length but no data
+		flags |= (1 << OBJ_RTR);
+		length = 0;
+	}
+	else {
+		// the payload is written up to the length given by the DLC,
+		// padded to whole words
+		length = (mcp2517fd_dlc_to_length(dlc) + 3) & ~3;
+	}
+	
+	mcp2517fd_start(FD_SPI_WRITE, address);
+	for (uint8_t i = 0; i < 4; i++) {
+		spi_putc(id);
+		id >>= 8;
+	}
+	spi_putc(flags | dlc);
+	spi_putc(0);
+	spi_putc(0);
+	spi_putc(0);
+	
+	for (uint8_t i = 0; i < length; i++) {
+		spi_putc((i < msg->length) ? msg->data[i] : 0);
+	}
+	HAL_CS_HIGH(MCP2517FD_CS);
+	
+	// append the object to the FIFO and request the transmission
+	mcp2517fd_write_byte(C1FIFOCON(FD_TX_FIFO) + 1,
+			(1 << FIFOCON_UINC) | (1 << FIFOCON_TXREQ));
+	
+	CAN_INDICATE_TX_TRAFFIC_FUNCTION;
+	
+	return 1;
+}
+
+#endif	// SUPPORT_FOR_MCP2517FD__
@@ -0,0 +1,65 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2517fd_private.h"
+#ifdef	SUPPORT_FOR_MCP2517FD__
+
+// ----------------------------------------------------------------------------
+void
+mcp2517fd_set_mode(can_mode_t mode)
+{
+	uint8_t reg;
+	
+	if (mode == LISTEN_ONLY_MODE) {
+		reg = FD_MODE_LISTEN_ONLY;
+	}
+	else if (mode == LOOPBACK_MODE) {
+		reg = FD_MODE_LOOPBACK;
+	}
+	else if (mode == SLEEP_MODE) {
+		reg = FD_MODE_SLEEP;
+	}
+	else {
+		#if SUPPORT_CAN_FD
+		reg = FD_MODE_NORMAL_FD;
+		#else
+		reg = FD_MODE_NORMAL_20;
+		#endif
+	}
+	
+	// switching between the operating modes is only possible
+	// through the configuration mode
+	if (reg != FD_MODE_SLEEP)
+		mcp2517fd_change_operation_mode(FD_MODE_CONFIG);
+	
+	mcp2517fd_change_operation_mode(reg);
+}
+
+#endif	// SUPPORT_FOR_MCP2517FD__
@@ -32,42 +32,16 @@
 #ifdef	SUPPORT_FOR_SJA1000__
 
 #if !SJA1000_MEMORY_MAPPED
-#define _NOP() do { __asm__ __volatile__ ("nop"); } while (0)
-
 void sja1000_write(uint8_t address, uint8_t data)
 {
-	// set address
-	SET(SJA1000_ALE);
-	PORT_(SJA1000_DATA) = address;
-	_NOP();
-	RESET(SJA1000_ALE);
-	
-	// write data
-	PORT_(SJA1000_DATA) = data;
-	RESET(SJA1000_WR);
-	_NOP();
-	SET(SJA1000_WR);
+	hal_bus_address(address);
+	hal_bus_write(data);
 }
 
 uint8_t sja1000_read(uint8_t address)
 {
-	uint8_t data;
-	
-	// set address
-	SET(SJA1000_ALE);
-	PORT_(SJA1000_DATA) = address;
-	_NOP();
-	RESET(SJA1000_ALE);
-	DDR_(SJA1000_DATA) = 0;
-	
-	// read data
-	RESET(SJA1000_RD);
-	_NOP();
-	data = PIN_(SJA1000_DATA);
-	SET(SJA1000_RD);
-	DDR_(SJA1000_DATA) = 0xff;
-	
-	return data;
+	hal_bus_address(address);
+	return hal_bus_read();
 }
 #endif
 
@@ -118,17 +92,7 @@ bool sja1000_init(uint8_t bitrate)
 		return false;
 	
 	#if !SJA1000_MEMORY_MAPPED
-		SET(SJA1000_WR);
-		SET(SJA1000_RD);
-		RESET(SJA1000_ALE);
-		RESET(SJA1000_CS);
-		
-		SET_OUTPUT(SJA1000_WR);
-		SET_OUTPUT(SJA1000_RD);
-		SET_OUTPUT(SJA1000_ALE);
-
-		SET_OUTPUT(SJA1000_CS);
-		DDR_(SJA1000_DATA) = 0xff;
+		hal_bus_init();
 	#endif
 	
 	// enter reset mode
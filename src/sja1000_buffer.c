@@ -31,6 +31,11 @@
 #include "sja1000_private.h"
 #ifdef	SUPPORT_FOR_SJA1000__
 
+// ----------------------------------------------------------------------------
+
+bool _sja1000_one_shot = false;
+bool _sja1000_one_shot_pending = false;
+
 // ----------------------------------------------------------------------------
 // Checks if there is any waiting message in the registers
 
@@ -44,8 +49,33 @@ bool sja1000_check_message(void)
 
 bool sja1000_check_free_buffer(void)
 {
+	uint8_t status = sja1000_read(SR);
+	
 	// if the TBS bit is set the CPU may write a message into the transmit buffer
-	return ((sja1000_read(SR) & (1<<TBS)) ? true : false);
+	if (!(status & (1<<TBS)))
+		return false;
+	
+	if (_sja1000_one_shot_pending)
+	{
+		_sja1000_one_shot_pending = false;
+		
+		// the single shot transmission was not completed
+		if (!(status & (1<<TCS)))
+		{
+			_can_statistics.tx_failed++;
+			
+			CAN_INDICATE_TX_FAILED_FUNCTION;
+		}
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void sja1000_set_one_shot(bool enable)
+{
+	_sja1000_one_shot = enable;
 }
 
 #endif	// SUPPORT_FOR_SJA1000__
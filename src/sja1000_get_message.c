@@ -102,6 +102,27 @@ uint8_t sja1000_get_message(can_t *msg)
 	
 	CAN_INDICATE_RX_TRAFFIC_FUNCTION;
 	
+	#if CAN_AUTO_REPLY_SLOTS > 0
+	if (msg->flags.rtr && _can_auto_reply(msg)) {
+		// remote frame was already answered
+		return FALSE;
+	}
+	#endif
+	
+	#if CAN_MAILBOX_SLOTS > 0
+	if (_can_mailbox_update(msg)) {
+		// message was stored in a mailbox
+		return FALSE;
+	}
+	#endif
+	
+	#if CAN_CHANGE_FILTER_SLOTS > 0
+	if (_can_suppress_unchanged(msg)) {
+		// content didn't change since the last message
+		return FALSE;
+	}
+	#endif
+	
 	return TRUE;
 }
 
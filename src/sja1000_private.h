@@ -113,6 +113,8 @@
 			#error in definition of SJA1000-pins (check SJA1000_WR, SJA1000_RD, SJA1000_CS, SJA1000_DATA and SJA1000_ALE)!
 		#endif
 		
+		#include "hal.h"
+		
 		#define	SUPPORT_FOR_SJA1000__		1
 		extern void sja1000_write(uint8_t address, uint8_t data);
 		extern uint8_t sja1000_read(uint8_t address);
@@ -120,6 +122,22 @@
 
 	#ifdef  SUPPORT_FOR_SJA1000__
 		#include "sja1000_defs.h"
+		
+		// one-shot mode: result of the last transmission not checked yet
+		extern bool _sja1000_one_shot;
+		extern bool _sja1000_one_shot_pending;
+		
+		// start the transmission of the transmit buffer
+		static inline void sja1000_transmit(void) {
+			if (_sja1000_one_shot) {
+				// single shot transmission
+				sja1000_write(CMR, (1<<TR)|(1<<AT));
+				_sja1000_one_shot_pending = true;
+			}
+			else {
+				sja1000_write(CMR, (1<<TR));
+			}
+		}
 	#endif
 #endif	// SUPPORT_SJA1000
 
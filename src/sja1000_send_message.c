@@ -41,6 +41,11 @@ uint8_t sja1000_send_message(const can_t *msg)
 	if (!sja1000_check_free_buffer() || (msg->length > 8))
 		return FALSE;
 	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit(msg))
+		return 0;
+	#endif
+	
 	frame_info = msg->length | ((msg->flags.rtr) ? (1<<RTR) : 0);
 	
 	if (msg->flags.extended)
@@ -79,7 +84,7 @@ uint8_t sja1000_send_message(const can_t *msg)
 	}
 	
 	// send buffer
-	sja1000_write(CMR, (1<<TR));
+	sja1000_transmit();
 	
 	CAN_INDICATE_TX_TRAFFIC_FUNCTION;
 	
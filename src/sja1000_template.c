@@ -0,0 +1,113 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "sja1000_private.h"
+#ifdef	SUPPORT_FOR_SJA1000__
+
+// ----------------------------------------------------------------------------
+// header[0] is the frame info, header[1..4] are the identifier registers
+// 17 .. 20 (only 17 and 18 are used for standard identifiers).
+
+void sja1000_prepare_template(can_template_t *tpl, const can_t *msg)
+{
+	uint8_t length = msg->length & 0x0f;
+	if (length > 8)
+		length = 8;
+	
+	uint8_t frame_info = length | ((msg->flags.rtr) ? (1<<RTR) : 0);
+	
+	if (msg->flags.extended)
+	{
+		tpl->header[0] = frame_info | (1<<FF);
+		tpl->header[1] = msg->id >> 21;
+		tpl->header[2] = msg->id >> 13;
+		tpl->header[3] = msg->id >> 5;
+		tpl->header[4] = msg->id << 3;
+	}
+	else
+	{
+		tpl->header[0] = frame_info;
+		tpl->header[1] = msg->id >> 3;
+		tpl->header[2] = msg->id << 5;
+		tpl->header[3] = 0;
+		tpl->header[4] = 0;
+	}
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	_can_rate_limit_prepare(tpl, msg);
+	#endif
+}
+
+// ----------------------------------------------------------------------------
+uint8_t sja1000_send_template(const can_template_t *tpl, const uint8_t *data)
+{
+	uint8_t frame_info = tpl->header[0];
+	uint8_t address;
+	
+	if (!sja1000_check_free_buffer())
+		return FALSE;
+	
+	#if CAN_RATE_LIMIT_CLASSES > 0
+	if (!_can_rate_limit_template(tpl))
+		return FALSE;
+	#endif
+	
+	sja1000_write(TX_INFO, frame_info);
+	sja1000_write(17, tpl->header[1]);
+	sja1000_write(18, tpl->header[2]);
+	
+	if (frame_info & (1<<FF))
+	{
+		sja1000_write(19, tpl->header[3]);
+		sja1000_write(20, tpl->header[4]);
+		
+		address = 21;
+	}
+	else {
+		address = 19;
+	}
+	
+	if (!(frame_info & (1<<RTR)))
+	{
+		uint8_t length = frame_info & 0x0f;
+		for (uint8_t i = 0;i < length; i++) {
+			sja1000_write(address + i, data[i]);
+		}
+	}
+	
+	// send buffer
+	sja1000_transmit();
+	
+	CAN_INDICATE_TX_TRAFFIC_FUNCTION;
+	
+	return TRUE;
+}
+
+#endif	// SUPPORT_FOR_SJA1000__
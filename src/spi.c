@@ -28,10 +28,10 @@
  */
 // ----------------------------------------------------------------------------
 
-#include "mcp2515_private.h"
-#ifdef	SUPPORT_FOR_MCP2515__
-
 #include "spi.h"
+#if defined(SUPPORT_FOR_SPI__) && !defined(SPI_SPIDEV) && !defined(CAN_HAL_HEADER)
+
+#include "utils.h"
 
 #ifdef	SPI_PRESCALER
 	#if (SPI_PRESCALER == 2) || (SPI_PRESCALER == 8) || (SPI_PRESCALER == 32) || (SPI_PRESCALER == 64)
@@ -62,13 +62,24 @@
 
 
 // ----------------------------------------------------------------------------
-void mcp2515_spi_init(void)
+bool spi_init(void)
 {
+	// Aktivieren der Pins fuer das SPI Interface
+	RESET(P_SCK);
+	RESET(P_MOSI);
+	RESET(P_MISO);
+	
+	SET_OUTPUT(P_SCK);
+	SET_OUTPUT(P_MOSI);
+	SET_INPUT(P_MISO);
+	
 	#ifndef USE_SOFTWARE_SPI
 		// Aktivieren des SPI Master Interfaces
 		SPCR = (1<<SPE)|(1<<MSTR) | R_SPCR;
 		SPSR = R_SPSR;
 	#endif
+	
+	return true;
 }
 
 // ----------------------------------------------------------------------------
@@ -118,4 +129,12 @@ uint8_t spi_putc(uint8_t data)
 	#endif
 }
 
-#endif	// SUPPORT_FOR_MCP2515__
+// ----------------------------------------------------------------------------
+void spi_read(uint8_t *data, uint8_t length)
+{
+	for (uint8_t i = 0; i < length; i++) {
+		data[i] = spi_putc(0xff);
+	}
+}
+
+#endif	// SUPPORT_FOR_SPI__
@@ -34,6 +34,58 @@
 
 #include "can_private.h"
 
+// ----------------------------------------------------------------------------
+// pins of the SPI interface, shared by the MCP2515 and the MCP2517FD
+//
+// For AVRs not listed here they can be defined in the configuration
+// (P_MOSI, P_MISO and P_SCK), with CAN_HAL_HEADER the SPI interface is
+// provided by the target (see hal.h).
+
+#if BUILD_FOR_MCP2515 || BUILD_FOR_MCP2517FD
+	#if defined(SPI_SPIDEV)
+		// Linux, the pins are handled by the spidev driver
+		#if BUILD_FOR_MCP2517FD
+			#error	SPI_SPIDEV is only available for the MCP2515
+		#endif
+		#define	SUPPORT_FOR_SPI__
+	#elif defined(CAN_HAL_HEADER)
+		#define	SUPPORT_FOR_SPI__
+	#elif defined(P_MOSI) && defined(P_MISO) && defined(P_SCK)
+		#define	SUPPORT_FOR_SPI__
+	#elif defined(__AVR_ATmega16__) || defined(__AVR_ATmega32__) || defined(__AVR_ATmega644__)
+		#define	P_MOSI	B,5
+		#define	P_MISO	B,6
+		#define	P_SCK	B,7
+		#define	SUPPORT_FOR_SPI__
+	#elif defined(__AVR_AT90USB82__) || defined(__AVR_AT90USB162__)
+		#define P_MOSI  B,2
+		#define P_MISO  B,3
+		#define P_SCK   B,1
+		#define SUPPORT_FOR_SPI__
+	#elif defined(__AVR_ATmega8__)  || defined(__AVR_ATmega48__) || \
+		  defined(__AVR_ATmega88__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || \
+		  defined(__AVR_ATmega48A__) || defined(__AVR_ATmega88A__) || defined(__AVR_ATmega168A__)
+		#define	P_MOSI	B,3
+		#define	P_MISO	B,4
+		#define	P_SCK	B,5
+		#define	SUPPORT_FOR_SPI__
+	#elif defined(__AVR_ATmega128__)
+		#define	P_MOSI	B,2
+		#define	P_MISO	B,3
+		#define	P_SCK	B,1
+		#define	SUPPORT_FOR_SPI__
+	#elif defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
+		#define	P_MOSI	B,0
+		#define	P_MISO	B,1
+		#define	P_SCK	B,2
+		
+		#define	USE_SOFTWARE_SPI		1
+		#define	SUPPORT_FOR_SPI__
+	#else
+		#error	unknown AVR-type, define P_MOSI, P_MISO and P_SCK!
+	#endif
+#endif
+
 // ----------------------------------------------------------------------------
 // load some default values
 
@@ -44,8 +96,12 @@
 // ----------------------------------------------------------------------------
 /**
  * \brief	Initialize SPI interface
+ *
+ * Activates the pins of the interface as well.
+ *
+ * \return	false if the interface couldn't be opened (only SPI_SPIDEV)
  */
-extern void mcp2515_spi_init(void);
+extern bool spi_init(void);
 
 // ----------------------------------------------------------------------------
 /**
@@ -57,20 +113,60 @@ extern void mcp2515_spi_init(void);
 extern uint8_t spi_putc(uint8_t data);
 
 // ----------------------------------------------------------------------------
-#ifdef USE_SOFTWARE_SPI
+/**
+ * \brief	Read a block of bytes from the slave
+ *
+ * With SPI_DEFERRED_READ the transfer is only queued and \a data is
+ * valid after the end of the transaction, otherwise it is read
+ * immediately.
+ */
+extern void spi_read(uint8_t *data, uint8_t length);
+
+// ----------------------------------------------------------------------------
+#if defined(SPI_SPIDEV)
 
-static uint8_t usi_interface_spi_temp;
+// All bytes between spi_select() and spi_deselect() are transferred with a
+// single SPI_IOC_MESSAGE ioctl when the transaction ends. spi_putc() only
+// queues the byte and can't return the answer of the slave, data has to be
+// read with spi_read().
+#define	SPI_DEFERRED_READ		1
+
+#ifndef	SPI_SPIDEV_SPEED
+	#define	SPI_SPIDEV_SPEED		10000000
+#endif
+
+extern void spi_select(void);
+
+extern void spi_deselect(void);
 
 extern __attribute__ ((gnu_inline)) inline void spi_start(uint8_t data) {
-	usi_interface_spi_temp = spi_putc(data);
+	spi_putc(data);
 }
 
 extern __attribute__ ((gnu_inline)) inline uint8_t spi_wait(void) {
+	return 0xff;
+}
+
+#elif defined(USE_SOFTWARE_SPI) || defined(CAN_HAL_HEADER)
+
+#ifndef	SPI_DEFERRED_READ
+	#define	SPI_DEFERRED_READ		0
+#endif
+
+static uint8_t usi_interface_spi_temp;
+
+static inline void spi_start(uint8_t data) {
+	usi_interface_spi_temp = spi_putc(data);
+}
+
+static inline uint8_t spi_wait(void) {
 	return usi_interface_spi_temp;
 }
 
 #else
 
+#define	SPI_DEFERRED_READ		0
+
 extern __attribute__ ((gnu_inline)) inline void spi_start(uint8_t data) {
 	SPDR = data;
 }
@@ -0,0 +1,174 @@
+// ----------------------------------------------------------------------------
+/*
+ * Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+ *  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $Id$
+ */
+// ----------------------------------------------------------------------------
+
+#include "spi.h"
+#ifdef	SPI_SPIDEV
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/spi/spidev.h>
+
+// ----------------------------------------------------------------------------
+// SPI interface for Linux (/dev/spidevX.Y)
+// 
+// spi_select() starts a new transaction. Consecutive bytes written with
+// spi_putc() are collected in one transfer, every spi_read() adds another
+// transfer which reads directly into the buffer of the caller.
+// spi_deselect() executes all of them with one SPI_IOC_MESSAGE ioctl,
+// during which the chip select stays active.
+
+// function used to access the device, can be replaced by a model of the
+// MCP2515 for tests
+#ifndef	SPI_SPIDEV_IOCTL
+	#define	SPI_SPIDEV_IOCTL		ioctl
+#endif
+
+// enough for the longest command of the MCP2515 (SPI_READ_RX or SPI_WRITE
+// with all twelve filter registers)
+#define	SPI_MAX_TRANSFERS			4
+#define	SPI_TX_BUFFER_SIZE			16
+
+static int _spi_fd = -1;
+
+static struct spi_ioc_transfer _spi_transfer[SPI_MAX_TRANSFERS];
+static uint8_t _spi_transfer_count;
+
+static uint8_t _spi_tx[SPI_TX_BUFFER_SIZE];
+static uint8_t _spi_tx_length;
+
+// ----------------------------------------------------------------------------
+bool spi_init(void)
+{
+	uint8_t mode = SPI_MODE_0;
+	uint8_t bits = 8;
+	uint32_t speed = SPI_SPIDEV_SPEED;
+	
+	if (_spi_fd < 0)
+	{
+		_spi_fd = open(SPI_SPIDEV, O_RDWR);
+		if (_spi_fd < 0)
+			return false;
+	}
+	
+	if (SPI_SPIDEV_IOCTL(_spi_fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+		SPI_SPIDEV_IOCTL(_spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+		SPI_SPIDEV_IOCTL(_spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0)
+	{
+		return false;
+	}
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+void spi_select(void)
+{
+	_spi_transfer_count = 0;
+	_spi_tx_length = 0;
+}
+
+// ----------------------------------------------------------------------------
+static struct spi_ioc_transfer *_spi_add_transfer(void)
+{
+	if (_spi_transfer_count >= SPI_MAX_TRANSFERS)
+		return NULL;
+	
+	struct spi_ioc_transfer *t = &_spi_transfer[_spi_transfer_count++];
+	memset(t, 0, sizeof(*t));
+	
+	return t;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t spi_putc(uint8_t data)
+{
+	if (_spi_tx_length >= SPI_TX_BUFFER_SIZE)
+		return 0xff;
+	
+	struct spi_ioc_transfer *t = NULL;
+	if (_spi_transfer_count > 0)
+	{
+		// append to the previous transfer if it is a write
+		t = &_spi_transfer[_spi_transfer_count - 1];
+		if (t->rx_buf != 0)
+			t = NULL;
+	}
+	
+	if (t == NULL)
+	{
+		t = _spi_add_transfer();
+		if (t == NULL)
+			return 0xff;
+		
+		t->tx_buf = (uintptr_t) &_spi_tx[_spi_tx_length];
+	}
+	
+	_spi_tx[_spi_tx_length++] = data;
+	t->len++;
+	
+	// the answer is only available with spi_read()
+	return 0xff;
+}
+
+// ----------------------------------------------------------------------------
+void spi_read(uint8_t *data, uint8_t length)
+{
+	struct spi_ioc_transfer *t = _spi_add_transfer();
+	if (t == NULL)
+		return;
+	
+	// without a transmit buffer spidev sends zeros
+	t->rx_buf = (uintptr_t) data;
+	t->len = length;
+}
+
+// ----------------------------------------------------------------------------
+void spi_deselect(void)
+{
+	if (_spi_transfer_count == 0)
+		return;
+	
+	if (SPI_SPIDEV_IOCTL(_spi_fd, SPI_IOC_MESSAGE(_spi_transfer_count), _spi_transfer) < 0)
+	{
+		// don't leave random data in the buffers of the caller
+		for (uint8_t i = 0; i < _spi_transfer_count; i++)
+		{
+			if (_spi_transfer[i].rx_buf != 0)
+				memset((void *) (uintptr_t) _spi_transfer[i].rx_buf, 0xff, _spi_transfer[i].len);
+		}
+	}
+	
+	_spi_transfer_count = 0;
+	_spi_tx_length = 0;
+}
+
+#endif	// SPI_SPIDEV
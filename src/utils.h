@@ -121,6 +121,12 @@ typedef struct {
 	
 	#define	IRQ_LOCK					ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 
+#elif !defined(__AVR__)
+
+	// Linux (SPI_SPIDEV), no interrupts
+	#define	ENTER_CRITICAL_SECTION		do {
+	#define	LEAVE_CRITICAL_SECTION		} while (0);
+
 #else
 
 	#define	ENTER_CRITICAL_SECTION		do { unsigned char sreg_ = SREG; cli();
@@ -0,0 +1,544 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# Copyright (c) 2007 Fabian Greif, Roboterclub Aachen e.V.
+#  All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+# OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+# OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+# SUCH DAMAGE.
+#
+# $Id$
+"""Generate a C header for the can-lib from a DBC file.
+
+For every message the header contains:
+
+- ID, length and cycle time (attribute GenMsgCycleTime) as defines
+- a struct with the raw values of all signals
+- pack and unpack functions, every signal is copied with constant shifts
+  and masks, there are no loops or branches at runtime
+- factor and offset of the signals to convert the raw values
+
+With --node only the messages sent and received by this node are used.
+The received messages are additionally put into a filter table for
+can_static_filter() (MCP2515) and a table for can_set_filter() (AT90CAN),
+the sent messages with a cycle time get numbers for
+can_set_periodic_message() (AT90CAN).
+
+Multiplexed signals are not supported, they are skipped with a warning.
+Messages longer than 8 bytes are CAN FD frames and need SUPPORT_CAN_FD.
+
+Example:
+
+    $ python3 dbc2can.py vehicle.dbc -o vehicle.h --node ECU1
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# -----------------------------------------------------------------------------
+class Signal:
+    def __init__(self, name, start, length, little_endian, signed,
+                 factor, offset, minimum, maximum, unit, receivers):
+        self.name = name
+        self.start = start
+        self.length = length
+        self.little_endian = little_endian
+        self.signed = signed
+        self.factor = factor
+        self.offset = offset
+        self.minimum = minimum
+        self.maximum = maximum
+        self.unit = unit
+        self.receivers = receivers
+
+    def bits(self):
+        """Position in the frame (0 = bit 0 of byte 0) of every bit of
+        the signal, starting with the least significant bit."""
+        if self.little_endian:
+            return [self.start + i for i in range(self.length)]
+
+        # Motorola: the start bit is the most significant bit, the next bits
+        # follow towards bit 0 of the byte and continue with bit 7 of the
+        # following byte
+        positions = []
+        pos = self.start
+        for _ in range(self.length):
+            positions.append(pos)
+            if pos % 8 == 0:
+                pos += 15
+            else:
+                pos -= 1
+        positions.reverse()
+        return positions
+
+    def pieces(self):
+        """Split the signal into parts which are contiguous within one
+        byte: (byte, bit in byte, first bit of the signal, number of bits)"""
+        result = []
+        for index, pos in enumerate(self.bits()):
+            byte, bit = divmod(pos, 8)
+            if result:
+                last = result[-1]
+                if last[0] == byte and last[1] + last[3] == bit:
+                    result[-1] = (byte, last[1], last[2], last[3] + 1)
+                    continue
+            result.append((byte, bit, index, 1))
+        return result
+
+
+class Message:
+    def __init__(self, can_id, name, length, sender):
+        self.extended = bool(can_id & 0x80000000)
+        self.id = can_id & 0x1fffffff
+        self.name = name
+        self.length = length
+        self.sender = sender
+        self.signals = []
+        self.cycle = 0
+
+    def receivers(self):
+        nodes = set()
+        for signal in self.signals:
+            nodes.update(signal.receivers)
+        return nodes
+
+
+# -----------------------------------------------------------------------------
+RE_MESSAGE = re.compile(r'^BO_\s+(\d+)\s+(\w+)\s*:\s*(\d+)\s+(\w+)')
+RE_SIGNAL = re.compile(
+    r'^SG_\s+(\w+)\s*(\w*)\s*:\s*(\d+)\|(\d+)@([01])([+-])\s*'
+    r'\(\s*([^,]+),\s*([^)]+)\)\s*\[\s*([^|]*)\|([^\]]*)\]\s*"([^"]*)"\s*(.*)$')
+RE_CYCLE = re.compile(r'^BA_\s+"GenMsgCycleTime"\s+BO_\s+(\d+)\s+(\d+)\s*;')
+
+# valid lengths of CAN FD frames above 8 bytes
+FD_LENGTHS = (12, 16, 20, 24, 32, 48, 64)
+
+
+def parse_dbc(filename):
+    messages = {}
+    message = None
+
+    with open(filename, encoding='latin-1') as f:
+        for number, line in enumerate(f, 1):
+            line = line.strip()
+
+            match = RE_MESSAGE.match(line)
+            if match:
+                can_id = int(match.group(1))
+                message = Message(can_id, match.group(2),
+                                  int(match.group(3)), match.group(4))
+                messages[can_id] = message
+                continue
+
+            match = RE_SIGNAL.match(line)
+            if match:
+                if message is None:
+                    raise ValueError('%s:%d: signal without message'
+                                     % (filename, number))
+                if match.group(2).startswith('m'):
+                    # the multiplexer itself (M) is a normal signal
+                    print('warning: %s.%s: multiplexed signals are not '
+                          'supported' % (message.name, match.group(1)),
+                          file=sys.stderr)
+                    continue
+
+                receivers = [r.strip() for r in match.group(12).split(',')]
+                message.signals.append(Signal(
+                    name=match.group(1),
+                    start=int(match.group(3)),
+                    length=int(match.group(4)),
+                    little_endian=(match.group(5) == '1'),
+                    signed=(match.group(6) == '-'),
+                    factor=float(match.group(7)),
+                    offset=float(match.group(8)),
+                    minimum=match.group(9).strip(),
+                    maximum=match.group(10).strip(),
+                    unit=match.group(11),
+                    receivers=[r for r in receivers if r and r != 'Vector__XXX']))
+                continue
+
+            if not line.startswith('SG_'):
+                message = None
+
+            match = RE_CYCLE.match(line)
+            if match:
+                can_id = int(match.group(1))
+                if can_id in messages:
+                    messages[can_id].cycle = int(match.group(2))
+
+    for message in messages.values():
+        if message.length > 8 and message.length not in FD_LENGTHS:
+            raise ValueError('%s: invalid length %d' % (message.name,
+                                                         message.length))
+        for signal in message.signals:
+            last = max(signal.bits())
+            if min(signal.bits()) < 0 or last >= 8 * message.length:
+                raise ValueError('%s.%s: signal exceeds the length of the '
+                                 'message' % (message.name, signal.name))
+            if signal.length > 64:
+                raise ValueError('%s.%s: signal longer than 64 bit'
+                                 % (message.name, signal.name))
+
+    return sorted(messages.values(), key=lambda m: (m.extended, m.id))
+
+
+# -----------------------------------------------------------------------------
+def c_type(signal):
+    for width in (8, 16, 32, 64):
+        if signal.length <= width:
+            break
+    return ('int%d_t' if signal.signed else 'uint%d_t') % width, width
+
+
+def c_mask(length):
+    return '0x%x' % ((1 << length) - 1)
+
+
+def c_number(value):
+    text = repr(float(value))
+    if text.endswith('.0'):
+        text = text[:-2]
+    return text
+
+
+def generate_pack(out, message, prefix):
+    name = prefix + message.name.lower()
+    out.append('static inline void\n%s_pack(can_t *msg, const %s_t *s)\n{'
+               % (name, name))
+    out.append('\tmsg->id = %s_ID;' % name.upper())
+    out.append('\tmsg->flags.rtr = 0;')
+    if message.extended:
+        out.append('\tmsg->flags.extended = 1;')
+    else:
+        out.append('\t#if SUPPORT_EXTENDED_CANID')
+        out.append('\tmsg->flags.extended = 0;')
+        out.append('\t#endif')
+    out.append('\t#if SUPPORT_CAN_FD')
+    out.append('\tmsg->flags.fd = %d;' % int(message.length > 8))
+    out.append('\tmsg->flags.brs = 0;')
+    out.append('\t#endif')
+    out.append('\tmsg->length = %d;' % message.length)
+
+    parts = [[] for _ in range(message.length)]
+    for signal in message.signals:
+        _, width = c_type(signal)
+        for byte, bit, first, count in signal.pieces():
+            value = 's->%s' % signal.name
+            if signal.signed and (width > 8 or first or bit or count < 8):
+                value = '(uint%d_t) %s' % (width, value)
+            if first:
+                value = '(%s >> %d)' % (value, first)
+            if bit + count < 8:
+                # the upper bits belong to other signals
+                value = '(%s & %s)' % (value, c_mask(count))
+            if bit:
+                value = '(%s << %d)' % (value, bit)
+            parts[byte].append('(uint8_t) %s' % value)
+
+    for byte, part in enumerate(parts):
+        if not part:
+            out.append('\tmsg->data[%d] = 0;' % byte)
+        else:
+            out.append('\tmsg->data[%d] = %s;' % (byte, ' |\n\t\t\t'.join(part)))
+    out.append('}\n')
+
+
+def generate_unpack(out, message, prefix):
+    name = prefix + message.name.lower()
+    out.append('static inline void\n%s_unpack(%s_t *s, const can_t *msg)\n{'
+               % (name, name))
+
+    for signal in message.signals:
+        type_name, width = c_type(signal)
+        raw = 'uint%d_t' % width
+        part = []
+        for byte, bit, first, count in signal.pieces():
+            value = 'msg->data[%d]' % byte
+            if bit:
+                value = '(%s >> %d)' % (value, bit)
+            if bit + count < 8:
+                value = '(%s & %s)' % (value, c_mask(count))
+            if width > 8:
+                value = '(%s) %s' % (raw, value)
+            if first:
+                value = '(%s << %d)' % (value, first)
+            part.append(value)
+        value = ' |\n\t\t\t'.join(part)
+        if len(part) > 1:
+            value = '(%s)' % value
+
+        if signal.signed and signal.length < width:
+            # sign extension without a branch: (x ^ m) - m
+            sign = '0x%x' % (1 << (signal.length - 1))
+            value = '(%s) ((%s) (%s ^ %s) - %s)' % (type_name, raw, value,
+                                                     sign, sign)
+        elif signal.signed:
+            value = '(%s) (%s) (%s)' % (type_name, raw, value)
+        out.append('\ts->%s = %s;' % (signal.name, value))
+    out.append('}\n')
+
+
+# -----------------------------------------------------------------------------
+def cover(ids, filters, bits):
+    """Find a mask and up to 'filters' values which accept all 'ids'.
+
+    Starting with an exact match, the bit whose removal from the mask
+    merges the most identifiers is cleared until the remaining values
+    fit into the filters. Afterwards bits are set again as long as the
+    values still fit. More messages than necessary might be accepted.
+    """
+    mask = (1 << bits) - 1
+    values = sorted(set(ids))
+    while len(values) > filters:
+        best = None
+        for bit in range(bits):
+            if not mask & (1 << bit):
+                continue
+            candidate = mask & ~(1 << bit)
+            count = len(set(i & candidate for i in ids))
+            if best is None or count < best[0]:
+                best = (count, candidate)
+        mask = best[1]
+        values = sorted(set(i & mask for i in ids))
+
+    # the last step might have merged more than necessary
+    for bit in range(bits):
+        candidate = mask | (1 << bit)
+        if candidate != mask and len(set(i & candidate for i in ids)) <= filters:
+            mask = candidate
+            values = sorted(set(i & mask for i in ids))
+    return mask, values
+
+
+def generate_filter(out, received, base):
+    standard = [m.id for m in received if not m.extended]
+    extended = [m.id for m in received if m.extended]
+
+    if not standard and not extended:
+        return
+
+    # RXB0: mask 0, filter 0 and 1; RXB1: mask 1, filter 2 .. 5
+    if standard and extended:
+        mask0, values0 = cover(standard, 2, 11)
+        mask1, values1 = cover(extended, 4, 29)
+        rxb0 = [('MCP2515_FILTER', v) for v in values0]
+        rxb1 = [('MCP2515_FILTER_EXTENDED', v) for v in values1]
+        masks = [('MCP2515_FILTER', mask0), ('MCP2515_FILTER_EXTENDED', mask1)]
+    else:
+        macro = 'MCP2515_FILTER' if standard else 'MCP2515_FILTER_EXTENDED'
+        mask, values = cover(standard or extended, 6, 11 if standard else 29)
+        values = [(macro, v) for v in values]
+        rxb0 = values[:2]
+        rxb1 = values[2:] or values[:1]
+        masks = [(macro, mask), (macro, mask)]
+
+    # unused filters repeat a used one
+    rxb0 = (rxb0 * 2)[:2]
+    rxb1 = (rxb1 * 4)[:4]
+
+    if extended:
+        out.append('#if !SUPPORT_EXTENDED_CANID')
+        out.append('\t#error\tthe filters need SUPPORT_EXTENDED_CANID')
+        out.append('#endif\n')
+
+    out.append('/// filter and masks for can_static_filter() (MCP2515)')
+    out.append('static const uint8_t %sfilter[] PROGMEM = {' % base)
+    for number, (macro, value) in enumerate(rxb0 + rxb1):
+        out.append('\t%s(0x%x),\t// Filter %d' % (macro, value, number))
+    out.append('\t')
+    for number, (macro, value) in enumerate(masks):
+        out.append('\t%s(0x%x),\t// Maske %d' % (macro, value, number))
+    out.append('};\n')
+
+    # one exact filter per message for the MObs of the AT90CAN
+    out.append('/// filters for can_set_filter() (AT90CAN)')
+    out.append('#define\t%sFILTER_COUNT\t%d\n' % (base.upper(), len(received)))
+    out.append('#if SUPPORT_EXTENDED_CANID')
+    out.append('\t#define\t_%sFILTER(id)\t\t\t{ id, 0x7ff, { 2, 2 } }'
+               % base.upper())
+    out.append('\t#define\t_%sFILTER_EXTENDED(id)\t{ id, 0x1fffffff, { 2, 3 } }'
+               % base.upper())
+    out.append('#else')
+    out.append('\t#define\t_%sFILTER(id)\t\t\t{ id, 0x7ff, { 2 } }'
+               % base.upper())
+    out.append('#endif\n')
+    out.append('static const can_filter_t %sfilter_list[] = {' % base)
+    for message in received:
+        macro = '_%sFILTER%s' % (base.upper(),
+                                 '_EXTENDED' if message.extended else '')
+        out.append('\t%s(0x%x),\t// %s' % (macro, message.id, message.name))
+    out.append('};\n')
+
+
+def generate_periodic(out, periodic, prefix, base):
+    if not periodic:
+        return
+
+    out.append('/// number of periodic messages, CAN_PERIODIC_MOBS has to be at least as big')
+    out.append('#define\t%sPERIODIC_COUNT\t%d\n' % (base.upper(), len(periodic)))
+
+    out.append('/**')
+    out.append(' * \\brief\tLoad all periodic messages into their MObs (AT90CAN)')
+    out.append(' *')
+    out.append(' * Afterwards the application sends them every <NAME>_CYCLE ms with')
+    out.append(' * can_send_periodic_message(<NAME>_PERIODIC, data, changed).')
+    out.append(' */')
+    out.append('static inline bool\n%sset_periodic(void)\n{' % base)
+    out.append('\tcan_t msg;')
+    out.append('\tbool result = true;')
+    out.append('\t')
+    for message in periodic:
+        name = prefix + message.name.lower()
+        out.append('\t%s_t %s = { 0 };' % (name, message.name.lower()))
+    out.append('\t')
+    for message in periodic:
+        name = prefix + message.name.lower()
+        out.append('\t%s_pack(&msg, &%s);' % (name, message.name.lower()))
+        out.append('\tresult &= can_set_periodic_message(%s_PERIODIC, &msg);'
+                   % name.upper())
+    out.append('\t')
+    out.append('\treturn result;')
+    out.append('}\n')
+
+
+# -----------------------------------------------------------------------------
+def generate(messages, filename, dbc, prefix, node):
+    guard = re.sub(r'\W', '_', os.path.basename(filename)).upper()
+
+    # prefix of the tables, e.g. 'vehicle_' for vehicle.h
+    base = prefix or re.sub(r'\W', '_', os.path.splitext(
+        os.path.basename(filename))[0]).lower() + '_'
+
+    if node:
+        sent = [m for m in messages if m.sender == node]
+        received = [m for m in messages if node in m.receivers()
+                    and m.sender != node]
+        messages = [m for m in messages if m in sent or m in received]
+    else:
+        sent = []
+        received = []
+    periodic = [m for m in sent if m.cycle]
+
+    out = []
+    out.append('// ' + '-' * 77)
+    out.append('// Generated by dbc2can.py from %s, do not edit!'
+               % os.path.basename(dbc))
+    if node:
+        out.append('// Node: %s' % node)
+    out.append('// ' + '-' * 77)
+    out.append('')
+    out.append('#ifndef\t%s' % guard)
+    out.append('#define\t%s\n' % guard)
+    out.append('#include <stdint.h>')
+    out.append('#include <stdbool.h>')
+    out.append('#include <avr/pgmspace.h>\n')
+    out.append('#include "can.h"\n')
+    out.append('#if defined (__cplusplus)')
+    out.append('\textern "C" {')
+    out.append('#endif\n')
+
+    for message in messages:
+        name = prefix + message.name.lower()
+        upper = name.upper()
+
+        out.append('// ' + '-' * 77)
+        out.append('// %s (sent by %s)\n' % (message.name, message.sender))
+        out.append('#define\t%s_ID\t\t0x%x' % (upper, message.id))
+        out.append('#define\t%s_EXTENDED\t%d' % (upper, int(message.extended)))
+        out.append('#define\t%s_LENGTH\t%d' % (upper, message.length))
+        if message.cycle:
+            out.append('#define\t%s_CYCLE\t%d' % (upper, message.cycle))
+        if message in periodic:
+            out.append('#define\t%s_PERIODIC\t%d'
+                       % (upper, periodic.index(message)))
+        out.append('')
+
+        for signal in message.signals:
+            signal_name = '%s_%s' % (upper, signal.name.upper())
+            out.append('#define\t%s_FACTOR\t%s' % (signal_name, c_number(signal.factor)))
+            out.append('#define\t%s_OFFSET\t%s' % (signal_name, c_number(signal.offset)))
+        if message.signals:
+            out.append('')
+
+        if message.length > 8:
+            out.append('#if !SUPPORT_CAN_FD')
+            out.append('\t#error\t%s is a CAN FD message, it needs SUPPORT_CAN_FD'
+                       % message.name)
+            out.append('#endif\n')
+
+        out.append('typedef struct {')
+        for signal in message.signals:
+            type_name, _ = c_type(signal)
+            comment = '%d bit' % signal.length
+            if signal.unit:
+                comment += ', %s' % signal.unit
+            if (signal.minimum, signal.maximum) not in (('', ''), ('0', '0')):
+                comment += ' [%s .. %s]' % (signal.minimum, signal.maximum)
+            out.append('\t%s %s;\t//!< %s' % (type_name, signal.name, comment))
+        out.append('} %s_t;\n' % name)
+
+        generate_pack(out, message, prefix)
+        generate_unpack(out, message, prefix)
+
+    generate_filter(out, received, base)
+    generate_periodic(out, periodic, prefix, base)
+
+    out.append('#if defined (__cplusplus)')
+    out.append('}')
+    out.append('#endif\n')
+    out.append('#endif\t// %s' % guard)
+
+    with open(filename, 'w', encoding='latin-1', newline='\n') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+# -----------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(
+        description='Generate pack/unpack functions and filters from a DBC file')
+    parser.add_argument('dbc', help='DBC file')
+    parser.add_argument('-o', '--output', required=True, help='header to generate')
+    parser.add_argument('-n', '--node',
+                        help='only messages sent or received by this node, '
+                        'generates filters and periodic messages')
+    parser.add_argument('-p', '--prefix', default='',
+                        help='prefix of all generated names')
+    args = parser.parse_args()
+
+    try:
+        messages = parse_dbc(args.dbc)
+    except (IOError, ValueError) as e:
+        print('error: %s' % e, file=sys.stderr)
+        return 1
+
+    if args.node and not any(m.sender == args.node or args.node in m.receivers()
+                             for m in messages):
+        print('error: node %s not found' % args.node, file=sys.stderr)
+        return 1
+
+    generate(messages, args.output, args.dbc, args.prefix, args.node)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())